@@ -5,7 +5,7 @@ int main(void) {
     char *keys = malloc(10 * sizeof(char));
     keys[0] = 'a'; keys[1] = 'b'; keys[2] = 'X'; keys[3] = 'Y'; keys[4] = '0';
     keys[5] = '1'; keys[6] = '?'; keys[7] = '$'; keys[8] = '~'; keys[9] = '@';
-    int i;
+    int i, num, size;
 
     int *values = malloc(10 * sizeof(int));
     for (i = 0; i < 10; i++) values[i] = i * i;
@@ -49,5 +49,56 @@ int main(void) {
     assert(hashlookup_search(lookup, 'Z') == -1);
     hashlookup_free(&lookup);
 
+    char *many = malloc(64 * sizeof(char));
+    int *many_values = malloc(64 * sizeof(int));
+    for (i = 0; i < 64; i++) {
+        many[i] = '0' + i;
+        many_values[i] = 3 * i;
+    }
+    for (num = 31; num <= 33; num++) {
+        lookup = hashlookup_build(many, many_values, num);
+        for (i = 0; i < num; i++) assert(hashlookup_search(lookup, many[i]) == many_values[i]);
+        for (i = num; i < 64; i++) assert(hashlookup_search(lookup, many[i]) == -1);
+        assert(hashlookup_search(lookup, '\0') == -1);
+        hashlookup_edit(&lookup, many[num - 1], 7);
+        assert(hashlookup_search(lookup, many[num - 1]) == 7);
+        hashlookup_free(&lookup);
+    }
+    lookup = hashlookup_build(many, many_values, 64);
+    for (i = 0; i < 64; i++) assert(hashlookup_search(lookup, many[i]) == many_values[i]);
+    assert(hashlookup_search(lookup, 'Z' + 64) == -1);
+    hashlookup_free(&lookup);
+    free(many);
+    free(many_values);
+
+    int *int_keys = malloc(1000 * sizeof(int)), *int_values = malloc(1000 * sizeof(int)), *slots = malloc(2000 * sizeof(int));
+    for (i = 0; i < 1000; i++) {
+        int_keys[i] = i * 7919 - 500000;
+        int_values[i] = i;
+    }
+    int sizes[5] = {0, 1, 5, 32, 1000};
+    for (size = 0; size < 5; size++) {
+        hash_lookup_int int_lookup = hashlookup_int_build(int_keys, int_values, sizes[size]);
+        for (i = 0; i < sizes[size]; i++) assert(hashlookup_int_search(int_lookup, int_keys[i]) == i);
+        assert(hashlookup_int_search(int_lookup, 1) == -1);
+        assert(hashlookup_int_search(int_lookup, int_keys[999] + 1) == -1);
+        hashlookup_int_slots(&int_lookup, int_keys, 1000, slots);
+        for (i = 0; i < 1000; i++) assert((slots[i] == -1) == (i >= sizes[size]));
+        for (i = 0; i < sizes[size]; i++) assert(int_lookup.values[slots[i]] == i);
+        for (i = 0; i < 1000; i++) slots[1000 + i] = i * 7919 - 499999;
+        hashlookup_int_slots(&int_lookup, &slots[1000], 1000, slots);
+        for (i = 0; i < 1000; i++) assert(slots[i] == -1);
+        if (sizes[size]) {
+            hashlookup_int_edit(&int_lookup, int_keys[0], 42);
+            assert(hashlookup_int_search(int_lookup, int_keys[0]) == 42);
+        }
+        hashlookup_int_edit(&int_lookup, 1, 42);
+        assert(hashlookup_int_search(int_lookup, 1) == -1);
+        hashlookup_int_free(&int_lookup);
+    }
+    free(int_keys);
+    free(int_values);
+    free(slots);
+
     return 0;
 }
\ No newline at end of file
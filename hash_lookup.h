@@ -2,6 +2,8 @@
     hash_lookup.h
     A dictionary for storing key-value pairs.
     Utilises the C Minimum Perfect Hashing library (http://cmph.sourceforge.net/)
+    Dictionaries of at most HASHLOOKUP_SMALL keys skip the perfect hash and compare the key against all of them at once.
+    Keys are single characters (hashlookup_*) or 32-bit integers (hashlookup_int_*).
 */
 
 #ifndef HASH_LOOKUP
@@ -9,14 +11,30 @@
 
 #include <cmph.h>
 #include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+    HASHLOOKUP_SMALL
+    Largest number of keys searched directly instead of through CMPH. The keys fill two 16-byte vectors.
+*/
+#define HASHLOOKUP_SMALL 32
+
+/*
+    HASHLOOKUP_BATCH
+    Number of keys hashed and prefetched before any of them is verified by hashlookup_int_slots.
+*/
+#define HASHLOOKUP_BATCH 16
 
 /*
     typedef struct hash_lookup
     Structure for holding the pairs.
     Components:
-        cmph_t *hash   - The hash function
+        cmph_t *hash   - The hash function, unused for at most HASHLOOKUP_SMALL items
         int    *values - The values
-        char   *keys   - The keys
+        char   *keys   - The keys, padded to HASHLOOKUP_SMALL for at most HASHLOOKUP_SMALL items
         int    num     - The number of items
 */
 typedef struct {
@@ -29,7 +47,7 @@ typedef struct {
     hashlookup_build
     Constructs a hash_lookup object.
     Components:
-        char **keys - A list of the keys as strings 1 character long
+        char *key_string - The keys, one character each
         int *values - A list of the values for each key
         int num - The number of key-value pairs
     Returns hash_lookup:
@@ -39,20 +57,20 @@ hash_lookup hashlookup_build(char *key_string, int *values, int num) {
     hash_lookup lookup;
     lookup.num = num;
 
-    if (num > 1) {
+    if (num <= HASHLOOKUP_SMALL) {
+        lookup.hash = NULL;
+        lookup.keys = calloc(HASHLOOKUP_SMALL, sizeof(char));
+        lookup.values = malloc(HASHLOOKUP_SMALL * sizeof(int));
+        memcpy(lookup.keys, key_string, num * sizeof(char));
+        memcpy(lookup.values, values, num * sizeof(int));
+    } else {
         int i;
-        char **keys = malloc(num * sizeof(char*));
-        for (i = 0; i < num; i++) {
-            keys[i] = malloc(sizeof(char) << 1);
-            keys[i][0] = key_string[i];
-            keys[i][1] = '\0';
-        }
-        cmph_io_adapter_t *source = cmph_io_vector_adapter(keys, num);
+        cmph_io_adapter_t *source = cmph_io_struct_vector_adapter(key_string, sizeof(char), 0, sizeof(char), num);
         cmph_config_t *config = cmph_config_new(source);
         cmph_config_set_algo(config, CMPH_CHD);
         lookup.hash = cmph_new(config);
         cmph_config_destroy(config);
-        cmph_io_vector_adapter_destroy(source);
+        cmph_io_struct_vector_adapter_destroy(source);
         lookup.keys = malloc(num * sizeof(char));
         lookup.values = malloc(num * sizeof(int));
 
@@ -64,16 +82,39 @@ hash_lookup hashlookup_build(char *key_string, int *values, int num) {
             lookup.keys[id] = key;
             lookup.values[id] = values[i];
         }
-    } else if (num == 1) {
-        lookup.keys = malloc(sizeof(char));
-        lookup.keys[0] = key_string[0];
-        lookup.values = malloc(sizeof(int));
-        lookup.values[0] = values[0];
     }
 
     return lookup;
 }
 
+/*
+    hashlookup_slot
+    Finds the index of a key in the dictionary.
+    Parameters:
+        hash_lookup *lookup - The dictionary to search
+        char        key     - The key to search for
+    Returns int:
+        Index of key in values if key \in keys
+        -1 otherwise
+*/
+static inline int hashlookup_slot(hash_lookup *lookup, char key) {
+    if (lookup->num <= HASHLOOKUP_SMALL) {
+#ifdef __SSE2__
+        __m128i k = _mm_set1_epi8(key);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)lookup->keys), k));
+        mask |= (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)&lookup->keys[16]), k)) << 16;
+        if (lookup->num < HASHLOOKUP_SMALL) mask &= (1U << lookup->num) - 1;
+        return (mask) ? __builtin_ctz(mask) : -1;
+#else
+        int i;
+        for (i = 0; i < lookup->num; i++) if (lookup->keys[i] == key) return i;
+        return -1;
+#endif
+    }
+    int id = cmph_search(lookup->hash, &key, 1);
+    return ((id < lookup->num) && (key == lookup->keys[id])) ? id : -1;
+}
+
 /*
     hashlookup_search
     Searches the dictionary for the corresponding value to a key.
@@ -85,10 +126,8 @@ hash_lookup hashlookup_build(char *key_string, int *values, int num) {
         -1 otherwise
 */
 int hashlookup_search(hash_lookup lookup, char key) {
-    if (lookup.num == 0) return -1;
-    if (lookup.num == 1) return (key == lookup.keys[0]) ? lookup.values[0] : -1;
-    int id = cmph_search(lookup.hash, &key, 1);
-    return ((id < lookup.num) && (key == lookup.keys[id])) ? lookup.values[id] : -1;
+    int id = hashlookup_slot(&lookup, key);
+    return (id != -1) ? lookup.values[id] : -1;
 }
 
 /*
@@ -103,11 +142,8 @@ int hashlookup_search(hash_lookup lookup, char key) {
         values[lookup.hash(key)] = value if key \in keys
 */
 void hashlookup_edit(hash_lookup *lookup, char key, int value) {
-    if ((lookup->num == 1) && (key == lookup->keys[0])) lookup->values[0] = value;
-    else if (lookup->num > 1) {
-        int id = cmph_search(lookup->hash, &key, 1);
-        if ((id < lookup->num) && (key == lookup->keys[id])) lookup->values[id] = value;
-    }
+    int id = hashlookup_slot(lookup, key);
+    if (id != -1) lookup->values[id] = value;
 }
 
 /*
@@ -117,11 +153,171 @@ void hashlookup_edit(hash_lookup *lookup, char key, int value) {
         hash_lookup *lookup - The dictionary to free
 */
 void hashlookup_free(hash_lookup *lookup) {
-    if (lookup->num > 0) {
-        if (lookup->num > 1) cmph_destroy(lookup->hash);
-        free(lookup->values);
-        free(lookup->keys);
+    if (lookup->num > HASHLOOKUP_SMALL) cmph_destroy(lookup->hash);
+    free(lookup->values);
+    free(lookup->keys);
+}
+
+/*
+    typedef struct hash_lookup_int
+    Structure for holding pairs with integer keys.
+    Components:
+        cmph_t *hash   - The hash function, unused for at most HASHLOOKUP_SMALL items
+        int    *values - The values
+        int    *keys   - The keys, padded to HASHLOOKUP_SMALL for at most HASHLOOKUP_SMALL items
+        int    num     - The number of items
+*/
+typedef struct {
+    cmph_t *hash;
+    int *values, num;
+    int *keys;
+} hash_lookup_int;
+
+/*
+    hashlookup_int_build
+    Constructs a hash_lookup_int object.
+    Parameters:
+        int *keys   - The distinct keys
+        int *values - A list of the values for each key
+        int num     - The number of key-value pairs
+    Returns hash_lookup_int:
+        The constructed dictionary
+*/
+hash_lookup_int hashlookup_int_build(int *keys, int *values, int num) {
+    hash_lookup_int lookup;
+    lookup.num = num;
+    lookup.hash = NULL;
+
+    if (num <= HASHLOOKUP_SMALL) {
+        lookup.keys = calloc(HASHLOOKUP_SMALL, sizeof(int));
+        lookup.values = malloc(HASHLOOKUP_SMALL * sizeof(int));
+        memcpy(lookup.keys, keys, num * sizeof(int));
+        memcpy(lookup.values, values, num * sizeof(int));
+    } else {
+        int i;
+        unsigned int id;
+        cmph_io_adapter_t *source = cmph_io_struct_vector_adapter(keys, sizeof(int), 0, sizeof(int), num);
+        cmph_config_t *config = cmph_config_new(source);
+        cmph_config_set_algo(config, CMPH_CHD);
+        lookup.hash = cmph_new(config);
+        cmph_config_destroy(config);
+        cmph_io_struct_vector_adapter_destroy(source);
+        lookup.keys = malloc(num * sizeof(int));
+        lookup.values = malloc(num * sizeof(int));
+        for (i = 0; i < num; i++) {
+            id = cmph_search(lookup.hash, (char*)&keys[i], sizeof(int));
+            lookup.keys[id] = keys[i];
+            lookup.values[id] = values[i];
+        }
     }
+
+    return lookup;
+}
+
+/*
+    hashlookup_int_slot
+    Finds the index of a key in the dictionary.
+    Parameters:
+        hash_lookup_int *lookup - The dictionary to search
+        int             key     - The key to search for
+    Returns int:
+        Index of key in values if key \in keys
+        -1 otherwise
+*/
+static inline int hashlookup_int_slot(hash_lookup_int *lookup, int key) {
+    if (lookup->num <= HASHLOOKUP_SMALL) {
+        int i;
+#ifdef __SSE2__
+        __m128i k = _mm_set1_epi32(key);
+        for (i = 0; i < lookup->num; i += 4) {
+            unsigned int mask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128((__m128i*)&lookup->keys[i]), k)));
+            if (lookup->num - i < 4) mask &= (1U << (lookup->num - i)) - 1;
+            if (mask) return i + __builtin_ctz(mask);
+        }
+#else
+        for (i = 0; i < lookup->num; i++) if (lookup->keys[i] == key) return i;
+#endif
+        return -1;
+    }
+    unsigned int id = cmph_search(lookup->hash, (char*)&key, sizeof(int));
+    return ((id < (unsigned int)lookup->num) && (key == lookup->keys[id])) ? (int)id : -1;
+}
+
+/*
+    hashlookup_int_search
+    Searches the dictionary for the corresponding value to a key.
+    Parameters:
+        hash_lookup_int lookup - The dictionary to search
+        int             key    - The key to search for
+    Returns int:
+        values[lookup.hash(key)] if key \in keys
+        -1 otherwise
+*/
+int hashlookup_int_search(hash_lookup_int lookup, int key) {
+    int id = hashlookup_int_slot(&lookup, key);
+    return (id != -1) ? lookup.values[id] : -1;
+}
+
+/*
+    hashlookup_int_edit
+    Sets values[lookup.hash(key)] to value if key is in the dictionary.
+    Parameters:
+        hash_lookup_int *lookup - The dictionary to edit
+        int             key     - The key to change
+        int             value   - The value to change it to
+    Returns void:
+        Parameter lookup modified by reference
+        values[lookup.hash(key)] = value if key \in keys
+*/
+void hashlookup_int_edit(hash_lookup_int *lookup, int key, int value) {
+    int id = hashlookup_int_slot(lookup, key);
+    if (id != -1) lookup->values[id] = value;
+}
+
+/*
+    hashlookup_int_slots
+    Finds the slots of a block of keys.
+    Parameters:
+        hash_lookup_int *lookup - The dictionary to search
+        int             *keys   - The keys to search for
+        int             count   - The number of keys
+        int             *slots  - Array of count elements for the slots
+    Returns void:
+        slots[i] set to the index of keys[i] in values, or -1 if keys[i] is not in the dictionary.
+    Notes:
+        Keys are hashed HASHLOOKUP_BATCH at a time and their slots prefetched before any is verified, so the cache misses
+        of a batch overlap rather than follow one another.
+*/
+void hashlookup_int_slots(hash_lookup_int *lookup, int *keys, int count, int *slots) {
+    int i, j, end;
+    unsigned int id;
+    if (lookup->num <= HASHLOOKUP_SMALL) {
+        for (i = 0; i < count; i++) slots[i] = hashlookup_int_slot(lookup, keys[i]);
+        return;
+    }
+    for (i = 0; i < count; i = end) {
+        end = (i + HASHLOOKUP_BATCH < count) ? i + HASHLOOKUP_BATCH : count;
+        for (j = i; j < end; j++) {
+            id = cmph_search(lookup->hash, (char*)&keys[j], sizeof(int));
+            if (id >= (unsigned int)lookup->num) id = 0;
+            __builtin_prefetch(&lookup->keys[id]);
+            __builtin_prefetch(&lookup->values[id], 1);
+            slots[j] = id;
+        }
+        for (j = i; j < end; j++) if (lookup->keys[slots[j]] != keys[j]) slots[j] = -1;
+    }
+}
+
+/*
+    hashlookup_int_free
+    Frees the dictionary.
+    Parameters:
+        hash_lookup_int *lookup - The dictionary to free
+*/
+void hashlookup_int_free(hash_lookup_int *lookup) {
+    if (lookup->num > HASHLOOKUP_SMALL) cmph_destroy(lookup->hash);
+    free(lookup->values);
+    free(lookup->keys);
 }
 
-#endif
\ No newline at end of file
+#endif
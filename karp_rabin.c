@@ -1,13 +1,21 @@
 #include "karp_rabin.h"
-#include <gmp.h>
 #include <stdio.h>
 #include <assert.h>
+#include <limits.h>
 
 int main(void) {
-    int *P = malloc(20 * sizeof(int));
+    int *P = malloc(20 * sizeof(int)), i;
     fingerprinter printer = fingerprinter_build(100, 0);
+#if defined(KARP_RABIN_WORD)
+    printf("p = %llu\n", (unsigned long long)printer->p);
+    printf("r = %llu\n", (unsigned long long)printer->r);
+#elif defined(KARP_RABIN_MULTI)
+    printf("p = %llu\n", (unsigned long long)printer->p[0]);
+    for (i = 0; i < KARP_RABIN_LANES; i++) printf("r[%d] = %llu\n", i, (unsigned long long)printer->r[i]);
+#else
     gmp_printf("p = %Zd\n", printer->p);
     gmp_printf("r = %Zd\n", printer->r);
+#endif
 
     P[0]  = 0; P[1]  = 0; P[2]  = 0; P[3]  = 0; P[4]  = 0;
     P[5]  = 1; P[6]  = 1; P[7]  = 1; P[8]  = 1; P[9]  = 1;
@@ -17,9 +25,14 @@ int main(void) {
     fingerprint print = init_fingerprint();
     set_fingerprint(printer, P, 20, print);
 
+#if defined(KARP_RABIN_WORD)
+    printf("uv finger = %llu\n", (unsigned long long)print->finger);
+#elif defined(KARP_RABIN_MULTI)
+    for (i = 0; i < KARP_RABIN_LANES; i++) printf("uv finger[%d] = %llu\n", i, (unsigned long long)print->finger[i]);
+#else
     gmp_printf("uv finger = %Zd\n", print->finger);
-    gmp_printf("uv r_k = %Zd\n", print->r_k);
-    gmp_printf("uv r_mk = %Zd\n", print->r_mk);
+#endif
+    printf("uv k = %d\n", print->k);
 
     fingerprint prefix = init_fingerprint();
     set_fingerprint(printer, P, 5, prefix);
@@ -55,12 +68,28 @@ int main(void) {
     fingerprint zeroed = init_fingerprint(), z = init_fingerprint();
     P[12] = 0;
     set_fingerprint(printer, P, 20, zeroed);
-    mpz_t r_z;
-    mpz_init(r_z);
-    mpz_powm_ui(r_z, printer->r, 12, printer->p);
-    fingerprint_zero(printer, print, 2, r_z, z);
+    residue r_z;
+    residue_init(r_z);
+    residue_pow_ui(printer, r_z, printer->r, 12);
+    fingerprint_zero(printer, print, 2, &r_z, z);
     assert(fingerprint_equals(z, zeroed));
 
+    residue r_k;
+    residue_init_set_ui(r_k, 1);
+    fingerprint appended = init_fingerprint();
+    for (i = 0; i < 20; i++) fingerprint_append(printer, appended, P[i], &r_k);
+    assert(fingerprint_equals(appended, zeroed));
+
+    fingerprinter seeded = fingerprinter_build_seeded(100, 0, 42), reseeded = fingerprinter_build_seeded(100, 0, 42);
+    assert(residue_equals(seeded->r, reseeded->r));
+    fingerprinter_free(seeded);
+    fingerprinter_free(reseeded);
+
+    assert(fingerprinter_cached(100, 0) == fingerprinter_cached(128, 0));
+    assert(fingerprinter_cached(100, 0) != fingerprinter_cached(129, 0));
+    assert(fingerprinter_cached(UINT_MAX, 0) == fingerprinter_cached(1U << 31, 0));
+    fingerprinter_cache_free();
+
     fingerprint_free(print);
     fingerprint_free(prefix);
     fingerprint_free(suffix);
@@ -2,15 +2,676 @@
     karp_rabin.h
     Library for Karp-Rabin fingerprints.
     Utilises the GNU Multile Precision Arithmetic library (https://gmplib.org/) and dev/urandom.
+    Compiling with -DKARP_RABIN_WORD replaces GMP with word-sized arithmetic modulo the Mersenne prime 2^61 - 1.
+    Compiling with -DKARP_RABIN_MULTI instead keeps KARP_RABIN_LANES independent residues modulo 2^31 - 1 in one vector.
+    All backends sit behind the same fingerprinter/fingerprint API; residues are only touched through the residue_* macros.
 */
 
 #ifndef KARP_RABIN
 #define KARP_RABIN
 
-#include <gmp.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/*
+    seed_state, seed_fixed
+    State for reproducible seeding, set by fingerprinter_seed.
+*/
+unsigned long long seed_state = 0;
+int seed_fixed = 0;
+pthread_mutex_t seed_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+    fingerprinter_seed
+    Makes every later fingerprinter_build reproducible.
+    Parameters:
+        unsigned long seed - The seed to derive every later fingerprinter from
+    Notes:
+        Seeds are drawn in order from one SplitMix64 sequence, so runs that build fingerprinters in the same order get the same ones.
+*/
+void fingerprinter_seed(unsigned long seed) {
+    pthread_mutex_lock(&seed_lock);
+    seed_state = seed;
+    seed_fixed = 1;
+    pthread_mutex_unlock(&seed_lock);
+}
+
+/*
+    splitmix64
+    Advances a SplitMix64 generator.
+    Parameters:
+        unsigned long long *state - The generator state
+    Returns unsigned long long:
+        The next output
+*/
+unsigned long long splitmix64(unsigned long long *state) {
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/*
+    random_seed
+    Reads a seed from /dev/urandom, or from the sequence set by fingerprinter_seed.
+    Returns unsigned long:
+        A random seed
+*/
+unsigned long random_seed() {
+    unsigned long seed;
+    size_t seed_len = 0;
+    int fixed;
+    pthread_mutex_lock(&seed_lock);
+    fixed = seed_fixed;
+    if (fixed) seed = splitmix64(&seed_state);
+    pthread_mutex_unlock(&seed_lock);
+    if (fixed) return seed;
+    int f = open("/dev/urandom", O_RDONLY);
+    while (seed_len < sizeof seed) {
+        size_t result = read(f, ((char*)&seed) + seed_len, (sizeof seed) - seed_len);
+        seed_len += result;
+    }
+    close(f);
+    return seed;
+}
+
+/*
+    power_bits
+    Number of power-of-two exponents needed to write any length up to n.
+    Parameters:
+        unsigned int n - The largest length
+    Returns int:
+        floor(log_2(n)) + 1, and at least 1
+*/
+int power_bits(unsigned int n) {
+    int bits = 1;
+    while (n >>= 1) bits++;
+    return bits;
+}
+
+#ifdef KARP_RABIN_WORD
+
+#include <stdint.h>
+
+/*
+    KARP_RABIN_PRIME
+    The fixed modulus p = 2^61 - 1 used by the word backend.
+    Notes:
+        Two distinct strings of length l collide with probability at most (l - 1)/p over the choice of r,
+        so a text of length n compared against windows of length at most n errs with probability at most n^2/2^61.
+        Unlike the GMP backend this does not improve with alpha; use the GMP backend if 1/n^(1+alpha) is required.
+        All values fingerprinted must be smaller than p, which holds for predecessor values of any int-indexed text.
+*/
+#define KARP_RABIN_PRIME 0x1FFFFFFFFFFFFFFFULL
+
+/*
+    KARP_RABIN_BACKEND
+    Identifies the backend and residue layout, so that saved fingerprints are only read back by a compatible build.
+*/
+#define KARP_RABIN_BACKEND 1
+
+typedef uint64_t residue;
+
+/*
+    mod_mersenne
+    Reduces a double-width number modulo 2^61 - 1.
+    Parameters:
+        unsigned __int128 x - The number to reduce, x < 2^122
+    Returns uint64_t:
+        x mod 2^61 - 1
+*/
+static inline uint64_t mod_mersenne(unsigned __int128 x) {
+    uint64_t r = ((uint64_t)x & KARP_RABIN_PRIME) + (uint64_t)(x >> 61);
+    r = (r & KARP_RABIN_PRIME) + (r >> 61);
+    return (r >= KARP_RABIN_PRIME) ? r - KARP_RABIN_PRIME : r;
+}
+
+static inline uint64_t add_mersenne(uint64_t x, uint64_t y) {
+    uint64_t r = x + y;
+    return (r >= KARP_RABIN_PRIME) ? r - KARP_RABIN_PRIME : r;
+}
+
+static inline uint64_t sub_mersenne(uint64_t x, uint64_t y) {
+    return (x >= y) ? x - y : x + KARP_RABIN_PRIME - y;
+}
+
+static inline uint64_t pow_mersenne(uint64_t x, uint64_t e) {
+    uint64_t r = 1;
+    while (e) {
+        if (e & 1) r = mod_mersenne((unsigned __int128)r * x);
+        x = mod_mersenne((unsigned __int128)x * x);
+        e >>= 1;
+    }
+    return r;
+}
+
+#define residue_init(x) ((x) = 0)
+#define residue_init_set_ui(x, v) ((x) = (v))
+#define residue_clear(x) ((void)0)
+#define residue_set(to, from) ((to) = (from))
+#define residue_set_ui(x, v) ((x) = (v))
+#define residue_equals(x, y) ((x) == (y))
+#define residue_mul(printer, x, y, z) ((x) = mod_mersenne((unsigned __int128)(y) * (z)))
+#define residue_addmul_ui(printer, x, y, v) ((x) = mod_mersenne((unsigned __int128)(y) * (unsigned int)(v) + (x)))
+#define residue_submul_ui(printer, x, y, v) ((x) = sub_mersenne((x), mod_mersenne((unsigned __int128)(y) * (unsigned int)(v))))
+#define residue_add(printer, x, y, z) ((x) = add_mersenne((y), (z)))
+#define residue_add_ui(printer, x, v) ((x) = add_mersenne((x), (unsigned int)(v)))
+#define residue_sub(printer, x, y, z) ((x) = sub_mersenne((y), (z)))
+#define residue_pow_ui(printer, x, y, e) ((x) = pow_mersenne((y), (e)))
+#define residue_invert(printer, x, y) ((x) = pow_mersenne((y), KARP_RABIN_PRIME - 2))
+#define residue_limb_bytes(printer) 0
+#define residue_init_at(x, d, bytes) ((x) = 0)
+
+/*
+    FINGERPRINT_LANES
+    Number of independent Horner accumulators used by residue_horner.
+    Element i of a string goes to lane i % FINGERPRINT_LANES, so each lane steps by r^FINGERPRINT_LANES.
+*/
+#define FINGERPRINT_LANES 16
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifdef __AVX512F__
+/*
+    mul_mersenne_avx512
+    Multiplies eight residues modulo 2^61 - 1 using 32x32->64 bit products.
+    With a = a1 2^32 + a0 and b = b1 2^32 + b0, 2^64 = 8 and 2^61 = 1 (mod p), so the partial products fold without a 128-bit multiply.
+*/
+static inline __m512i mul_mersenne_avx512(__m512i a, __m512i b) {
+    const __m512i p = _mm512_set1_epi64(KARP_RABIN_PRIME), low29 = _mm512_set1_epi64((1ULL << 29) - 1);
+    __m512i a1 = _mm512_srli_epi64(a, 32), b1 = _mm512_srli_epi64(b, 32);
+    __m512i lo = _mm512_mul_epu32(a, b), hi = _mm512_mul_epu32(a1, b1);
+    __m512i mid = _mm512_add_epi64(_mm512_mul_epu32(a1, b), _mm512_mul_epu32(a, b1));
+    __m512i x = _mm512_add_epi64(_mm512_slli_epi64(hi, 3), _mm512_srli_epi64(mid, 29));
+    x = _mm512_add_epi64(x, _mm512_slli_epi64(_mm512_and_si512(mid, low29), 32));
+    x = _mm512_add_epi64(x, _mm512_add_epi64(_mm512_and_si512(lo, p), _mm512_srli_epi64(lo, 61)));
+    x = _mm512_add_epi64(_mm512_and_si512(x, p), _mm512_srli_epi64(x, 61));
+    return _mm512_mask_sub_epi64(x, _mm512_cmpge_epu64_mask(x, p), x, p);
+}
+#elif defined(__AVX2__)
+/*
+    mul_mersenne_avx2
+    Multiplies four residues modulo 2^61 - 1 using 32x32->64 bit products, as in mul_mersenne_avx512.
+*/
+static inline __m256i mul_mersenne_avx2(__m256i a, __m256i b) {
+    const __m256i p = _mm256_set1_epi64x(KARP_RABIN_PRIME), low29 = _mm256_set1_epi64x((1ULL << 29) - 1);
+    __m256i a1 = _mm256_srli_epi64(a, 32), b1 = _mm256_srli_epi64(b, 32);
+    __m256i lo = _mm256_mul_epu32(a, b), hi = _mm256_mul_epu32(a1, b1);
+    __m256i mid = _mm256_add_epi64(_mm256_mul_epu32(a1, b), _mm256_mul_epu32(a, b1));
+    __m256i x = _mm256_add_epi64(_mm256_slli_epi64(hi, 3), _mm256_srli_epi64(mid, 29));
+    x = _mm256_add_epi64(x, _mm256_slli_epi64(_mm256_and_si256(mid, low29), 32));
+    x = _mm256_add_epi64(x, _mm256_add_epi64(_mm256_and_si256(lo, p), _mm256_srli_epi64(lo, 61)));
+    x = _mm256_add_epi64(_mm256_and_si256(x, p), _mm256_srli_epi64(x, 61));
+    return _mm256_sub_epi64(x, _mm256_and_si256(_mm256_cmpgt_epi64(x, _mm256_sub_epi64(p, _mm256_set1_epi64x(1))), p));
+}
+
+static inline __m256i add_mersenne_avx2(__m256i x, __m256i y) {
+    const __m256i p = _mm256_set1_epi64x(KARP_RABIN_PRIME);
+    x = _mm256_add_epi64(x, y);
+    return _mm256_sub_epi64(x, _mm256_and_si256(_mm256_cmpgt_epi64(x, _mm256_sub_epi64(p, _mm256_set1_epi64x(1))), p));
+}
+#endif
+
+/*
+    typedef struct fingerprinter_t *fingerprinter
+    Structure to hold numbers for computing fingerprints.
+    Components:
+        residue p        - Prime number, always 2^61 - 1
+        residue r        - Random number such that 0 < r < p
+        residue r_lane   - r^FINGERPRINT_LANES, the stride between consecutive elements of one lane
+        residue *r_pow2  - r^(2^b) for 0 <= b < bits
+        residue *r_mpow2 - r^-(2^b) for 0 <= b < bits
+        int     bits     - Number of cached powers
+*/
+typedef struct fingerprinter_t {
+    residue p, r, r_lane, *r_pow2, *r_mpow2;
+    int bits;
+} *fingerprinter;
+
+void fingerprinter_extend(fingerprinter printer, int bits);
+
+/*
+    fingerprinter_build_from
+    Reconstructs a fingerprinter from its prime and base, for example when loading a saved pattern.
+    Parameters:
+        residue *p   - Prime number
+        residue *r   - Base such that 0 < r < p
+        int     bits - Number of powers of r to cache
+    Returns fingerprinter:
+        The constructed fingerprint
+*/
+fingerprinter fingerprinter_build_from(residue *p, residue *r, int bits) {
+    fingerprinter printer = malloc(sizeof(struct fingerprinter_t));
+    printer->p = *p;
+    printer->r = *r;
+    printer->r_lane = pow_mersenne(printer->r, FINGERPRINT_LANES);
+
+    printer->r_pow2 = malloc(sizeof(residue));
+    printer->r_mpow2 = malloc(sizeof(residue));
+    printer->r_pow2[0] = printer->r;
+    residue_invert(printer, printer->r_mpow2[0], printer->r);
+    printer->bits = 1;
+    fingerprinter_extend(printer, bits);
+
+    return printer;
+}
+
+/*
+    fingerprinter_build_seeded
+    Constructs a fingerprint for a problem size and accuracy from a given seed.
+    Parameters:
+        unsigned int  n     - Size of the text
+        unsigned int  alpha - Desired accuracy
+        unsigned long seed  - Seed for choosing r
+    Returns fingerprinter:
+        The constructed fingerprint
+    Notes:
+        n and alpha are ignored as the modulus is fixed; see KARP_RABIN_PRIME for the collision bound.
+*/
+fingerprinter fingerprinter_build_seeded(unsigned int n, unsigned int alpha, unsigned long seed) {
+    residue p = KARP_RABIN_PRIME, r = seed % (KARP_RABIN_PRIME - 1) + 1;
+    return fingerprinter_build_from(&p, &r, power_bits(n));
+}
+
+/*
+    fingerprinter_free
+    Frees a fingerprinter from memory.
+    Parameters:
+        fingerprinter printer - The fingerprinter to free
+*/
+void fingerprinter_free(fingerprinter printer) {
+    free(printer->r_pow2);
+    free(printer->r_mpow2);
+    free(printer);
+}
+
+/*
+    residue_horner
+    Fingerprints a string, sum T[i] r^i.
+    Parameters:
+        fingerprinter printer - The printer to use
+        residue       *x      - The residue to set
+        int           *T      - The string
+        unsigned int  l       - The length of the string
+    Returns void:
+        Parameter x modified by reference to the fingerprint of T.
+    Notes:
+        The string is split into FINGERPRINT_LANES interleaved lanes that run Horner's rule with stride r^FINGERPRINT_LANES.
+        The lanes are then combined with one more Horner pass over r. The lanes are vectorised with AVX-512 or AVX2 if available.
+        Otherwise they run as independent scalar chains.
+*/
+void residue_horner(fingerprinter printer, residue *x, int *T, unsigned int l) {
+    uint64_t acc[FINGERPRINT_LANES];
+    int i, q, blocks = l / FINGERPRINT_LANES, tail = l % FINGERPRINT_LANES;
+
+    for (q = 0; q < FINGERPRINT_LANES; q++) acc[q] = (q < tail) ? (unsigned int)T[blocks * FINGERPRINT_LANES + q] : 0;
+#if defined(__AVX512F__)
+    const __m512i p = _mm512_set1_epi64(KARP_RABIN_PRIME), stride = _mm512_set1_epi64(printer->r_lane);
+    __m512i v[FINGERPRINT_LANES / 8];
+    for (q = 0; q < FINGERPRINT_LANES / 8; q++) v[q] = _mm512_loadu_si512(&acc[q * 8]);
+    for (i = blocks - 1; i >= 0; i--) {
+        for (q = 0; q < FINGERPRINT_LANES / 8; q++) {
+            v[q] = mul_mersenne_avx512(v[q], stride);
+            v[q] = _mm512_add_epi64(v[q], _mm512_cvtepu32_epi64(_mm256_loadu_si256((__m256i*)&T[i * FINGERPRINT_LANES + q * 8])));
+            v[q] = _mm512_mask_sub_epi64(v[q], _mm512_cmpge_epu64_mask(v[q], p), v[q], p);
+        }
+    }
+    for (q = 0; q < FINGERPRINT_LANES / 8; q++) _mm512_storeu_si512(&acc[q * 8], v[q]);
+#elif defined(__AVX2__)
+    const __m256i stride = _mm256_set1_epi64x(printer->r_lane);
+    __m256i v[FINGERPRINT_LANES / 4];
+    for (q = 0; q < FINGERPRINT_LANES / 4; q++) v[q] = _mm256_loadu_si256((__m256i*)&acc[q * 4]);
+    for (i = blocks - 1; i >= 0; i--) {
+        for (q = 0; q < FINGERPRINT_LANES / 4; q++) {
+            v[q] = add_mersenne_avx2(mul_mersenne_avx2(v[q], stride), _mm256_cvtepu32_epi64(_mm_loadu_si128((__m128i*)&T[i * FINGERPRINT_LANES + q * 4])));
+        }
+    }
+    for (q = 0; q < FINGERPRINT_LANES / 4; q++) _mm256_storeu_si256((__m256i*)&acc[q * 4], v[q]);
+#else
+    for (i = blocks - 1; i >= 0; i--) {
+        for (q = 0; q < FINGERPRINT_LANES; q++) {
+            acc[q] = mod_mersenne((unsigned __int128)acc[q] * printer->r_lane + (unsigned int)T[i * FINGERPRINT_LANES + q]);
+        }
+    }
+#endif
+
+    *x = acc[FINGERPRINT_LANES - 1];
+    for (q = FINGERPRINT_LANES - 2; q >= 0; q--) *x = add_mersenne(mod_mersenne((unsigned __int128)*x * printer->r), acc[q]);
+}
+
+/*
+    residue_write
+    Appends a residue to a file in the layout read back by residue_read.
+    Parameters:
+        FILE    *file - The file
+        residue *x    - The residue
+    Returns int:
+        1 on success
+        0 if the write failed
+    Notes:
+        The 8 bytes of the word, in host byte order.
+*/
+int residue_write(FILE *file, residue *x) {
+    return fwrite(x, sizeof(residue), 1, file) == 1;
+}
+
+/*
+    residue_read
+    Reads a residue written by residue_write.
+    Parameters:
+        const char **data - The next byte to read, advanced past the residue
+        const char *end   - The end of the buffer
+        residue    *x     - The residue to set
+    Returns int:
+        1 on success
+        0 if the buffer is too short
+*/
+int residue_read(const char **data, const char *end, residue *x) {
+    if (end - *data < (long)sizeof(residue)) return 0;
+    memcpy(x, *data, sizeof(residue));
+    *data += sizeof(residue);
+    return 1;
+}
+
+/*
+    residue_reduced
+    Checks that a residue read from a file is reduced modulo p.
+    Parameters:
+        residue *x - The residue
+        residue *p - The prime
+    Returns int:
+        1 if x < p
+        0 otherwise
+*/
+int residue_reduced(residue *x, residue *p) {
+    return *x < *p;
+}
+
+/*
+    fingerprinter_valid
+    Checks a prime and base read from a file before they are passed to fingerprinter_build_from.
+    Parameters:
+        residue *p - Prime number
+        residue *r - Base
+    Returns int:
+        1 if p is 2^61 - 1 and 0 < r < p
+        0 otherwise
+*/
+int fingerprinter_valid(residue *p, residue *r) {
+    return (*p == KARP_RABIN_PRIME) && (*r) && (*r < *p);
+}
+
+#elif defined(KARP_RABIN_MULTI)
+
+#include <stdint.h>
+
+/*
+    KARP_RABIN_PRIME31, KARP_RABIN_LANES
+    The multi-lane backend keeps KARP_RABIN_LANES (2, 4 or 8) residues modulo p = 2^31 - 1, each with its own random base.
+    Notes:
+        Each lane is an independent Karp-Rabin fingerprint, so two distinct strings of length l collide with probability
+        at most ((l - 1)/p)^KARP_RABIN_LANES. With four lanes and windows of up to 2^20 symbols this is 2^-44 per comparison,
+        comparable to the GMP backend for texts of a few billion symbols, without multi-limb arithmetic.
+        Every operation works on all lanes at once; with AVX2 (four lanes) or AVX-512F (eight lanes) a residue is one register.
+*/
+#define KARP_RABIN_PRIME31 0x7FFFFFFFULL
+#ifndef KARP_RABIN_LANES
+#define KARP_RABIN_LANES 4
+#endif
+
+typedef uint64_t residue __attribute__((vector_size(KARP_RABIN_LANES * 8), aligned(8)));
+
+/*
+    KARP_RABIN_BACKEND
+    Identifies the backend and residue layout, so that saved fingerprints are only read back by a compatible build.
+*/
+#define KARP_RABIN_BACKEND ((KARP_RABIN_LANES << 8) | 2)
+
+#if (defined(__AVX2__) && KARP_RABIN_LANES == 4) || (defined(__AVX512F__) && KARP_RABIN_LANES == 8)
+#include <immintrin.h>
+#endif
+
+/*
+    mod_lanes
+    Reduces every lane modulo 2^31 - 1. The lane helpers take residues by pointer, as passing a vector wider than the
+    enabled instruction set by value changes the ABI.
+    Parameters:
+        residue *x - The lanes to reduce, each below 2^64
+    Returns void:
+        Parameter x modified by reference to x mod 2^31 - 1 in every lane.
+*/
+static inline void mod_lanes(residue *x) {
+    *x = (*x & KARP_RABIN_PRIME31) + (*x >> 31);
+    *x = (*x & KARP_RABIN_PRIME31) + (*x >> 31);
+    *x -= (residue)(*x >= KARP_RABIN_PRIME31) & KARP_RABIN_PRIME31;
+}
+
+static inline void mul_lanes(residue *x, const residue *y, const residue *z) {
+#if defined(__AVX2__) && KARP_RABIN_LANES == 4
+    *x = (residue)_mm256_mul_epu32((__m256i)*y, (__m256i)*z);
+#elif defined(__AVX512F__) && KARP_RABIN_LANES == 8
+    *x = (residue)_mm512_mul_epu32((__m512i)*y, (__m512i)*z);
+#else
+    *x = *y * *z;
+#endif
+    mod_lanes(x);
+}
+
+static inline void pow_lanes(residue *x, const residue *y, uint64_t e) {
+    residue b = *y, r = *y - *y + 1;
+    while (e) {
+        if (e & 1) mul_lanes(&r, &r, &b);
+        mul_lanes(&b, &b, &b);
+        e >>= 1;
+    }
+    *x = r;
+}
+
+static inline int equals_lanes(const residue *x, const residue *y) {
+    residue d = *x ^ *y;
+    uint64_t any = 0;
+    int q;
+    for (q = 0; q < KARP_RABIN_LANES; q++) any |= d[q];
+    return !any;
+}
+
+#define residue_init(x) ((x) = (residue){0})
+#define residue_init_set_ui(x, v) ((x) = (residue){0} + (uint64_t)(v), mod_lanes(&(x)))
+#define residue_clear(x) ((void)0)
+#define residue_set(to, from) ((to) = (from))
+#define residue_set_ui(x, v) residue_init_set_ui(x, v)
+#define residue_equals(x, y) equals_lanes(&(x), &(y))
+#define residue_mul(printer, x, y, z) mul_lanes(&(x), &(y), &(z))
+#define residue_addmul_ui(printer, x, y, v) ((x) = (y) * (uint64_t)(unsigned int)(v) + (x), mod_lanes(&(x)))
+#define residue_submul_ui(printer, x, y, v) ({ residue t_ = (y) * (uint64_t)(unsigned int)(v); mod_lanes(&t_); (x) = (x) + KARP_RABIN_PRIME31 - t_; mod_lanes(&(x)); })
+#define residue_add(printer, x, y, z) ((x) = (y) + (z), mod_lanes(&(x)))
+#define residue_add_ui(printer, x, v) ((x) = (x) + (uint64_t)(unsigned int)(v), mod_lanes(&(x)))
+#define residue_sub(printer, x, y, z) ((x) = (y) + KARP_RABIN_PRIME31 - (z), mod_lanes(&(x)))
+#define residue_pow_ui(printer, x, y, e) pow_lanes(&(x), &(y), (e))
+#define residue_invert(printer, x, y) pow_lanes(&(x), &(y), KARP_RABIN_PRIME31 - 2)
+#define residue_limb_bytes(printer) 0
+#define residue_init_at(x, d, bytes) residue_init(x)
+
+/*
+    typedef struct fingerprinter_t *fingerprinter
+    Structure to hold numbers for computing fingerprints.
+    Components:
+        residue p        - Prime number 2^31 - 1 in every lane
+        residue r        - Independent random numbers such that 0 < r < p
+        residue *r_pow2  - r^(2^b) for 0 <= b < bits
+        residue *r_mpow2 - r^-(2^b) for 0 <= b < bits
+        int     bits     - Number of cached powers
+*/
+typedef struct fingerprinter_t {
+    residue p, r, *r_pow2, *r_mpow2;
+    int bits;
+} *fingerprinter;
+
+void fingerprinter_extend(fingerprinter printer, int bits);
+
+/*
+    fingerprinter_build_from
+    Reconstructs a fingerprinter from its prime and base, for example when loading a saved pattern.
+    Parameters:
+        residue *p   - Prime number in every lane
+        residue *r   - Base of every lane, 0 < r < p
+        int     bits - Number of powers of r to cache
+    Returns fingerprinter:
+        The constructed fingerprint
+*/
+fingerprinter fingerprinter_build_from(residue *p, residue *r, int bits) {
+    fingerprinter printer = malloc(sizeof(struct fingerprinter_t));
+    printer->p = *p;
+    printer->r = *r;
+
+    printer->r_pow2 = malloc(sizeof(residue));
+    printer->r_mpow2 = malloc(sizeof(residue));
+    printer->r_pow2[0] = printer->r;
+    residue_invert(printer, printer->r_mpow2[0], printer->r);
+    printer->bits = 1;
+    fingerprinter_extend(printer, bits);
+
+    return printer;
+}
+
+/*
+    fingerprinter_build_seeded
+    Constructs a fingerprint for a problem size and accuracy from a given seed.
+    Parameters:
+        unsigned int  n     - Size of the text
+        unsigned int  alpha - Desired accuracy
+        unsigned long seed  - Seed for choosing the bases of every lane
+    Returns fingerprinter:
+        The constructed fingerprint
+    Notes:
+        alpha is ignored as the modulus is fixed; see KARP_RABIN_LANES for the collision bound.
+*/
+fingerprinter fingerprinter_build_seeded(unsigned int n, unsigned int alpha, unsigned long seed) {
+    unsigned long long state = seed;
+    residue p, r;
+    int q;
+    residue_init(p);
+    p += KARP_RABIN_PRIME31;
+    for (q = 0; q < KARP_RABIN_LANES; q++) r[q] = splitmix64(&state) % (KARP_RABIN_PRIME31 - 1) + 1;
+    return fingerprinter_build_from(&p, &r, power_bits(n));
+}
+
+/*
+    fingerprinter_free
+    Frees a fingerprinter from memory.
+    Parameters:
+        fingerprinter printer - The fingerprinter to free
+*/
+void fingerprinter_free(fingerprinter printer) {
+    free(printer->r_pow2);
+    free(printer->r_mpow2);
+    free(printer);
+}
+
+/*
+    residue_horner
+    Fingerprints a string, sum T[i] r^i, in every lane at once.
+    Parameters:
+        fingerprinter printer - The printer to use
+        residue       *x      - The residue to set
+        int           *T      - The string
+        unsigned int  l       - The length of the string
+    Returns void:
+        Parameter x modified by reference to the fingerprint of T.
+*/
+void residue_horner(fingerprinter printer, residue *x, int *T, unsigned int l) {
+    int i;
+
+    residue_init(*x);
+    for (i = l - 1; i >= 0; i--) {
+        mul_lanes(x, x, &printer->r);
+        *x += (uint64_t)(unsigned int)T[i];
+        mod_lanes(x);
+    }
+}
+
+/*
+    residue_write
+    Appends a residue to a file in the layout read back by residue_read.
+    Parameters:
+        FILE    *file - The file
+        residue *x    - The residue
+    Returns int:
+        1 on success
+        0 if the write failed
+    Notes:
+        The 8 bytes of every lane, in host byte order.
+*/
+int residue_write(FILE *file, residue *x) {
+    return fwrite(x, sizeof(residue), 1, file) == 1;
+}
+
+/*
+    residue_read
+    Reads a residue written by residue_write.
+    Parameters:
+        const char **data - The next byte to read, advanced past the residue
+        const char *end   - The end of the buffer
+        residue    *x     - The residue to set
+    Returns int:
+        1 on success
+        0 if the buffer is too short
+*/
+int residue_read(const char **data, const char *end, residue *x) {
+    if (end - *data < (long)sizeof(residue)) return 0;
+    memcpy(x, *data, sizeof(residue));
+    *data += sizeof(residue);
+    return 1;
+}
+
+/*
+    residue_reduced
+    Checks that a residue read from a file is reduced modulo p.
+    Parameters:
+        residue *x - The residue
+        residue *p - The prime in every lane
+    Returns int:
+        1 if x < p in every lane
+        0 otherwise
+*/
+int residue_reduced(residue *x, residue *p) {
+    int q;
+    for (q = 0; q < KARP_RABIN_LANES; q++) if ((*x)[q] >= (*p)[q]) return 0;
+    return 1;
+}
+
+/*
+    fingerprinter_valid
+    Checks a prime and base read from a file before they are passed to fingerprinter_build_from.
+    Parameters:
+        residue *p - Prime number in every lane
+        residue *r - Base of every lane
+    Returns int:
+        1 if every lane of p is 2^31 - 1 and 0 < r < p in every lane
+        0 otherwise
+*/
+int fingerprinter_valid(residue *p, residue *r) {
+    int q;
+    for (q = 0; q < KARP_RABIN_LANES; q++) if (((*p)[q] != KARP_RABIN_PRIME31) || !(*r)[q] || ((*r)[q] >= (*p)[q])) return 0;
+    return 1;
+}
+
+#else
+
+#include <gmp.h>
+#include <stdint.h>
+
+/*
+    KARP_RABIN_BACKEND
+    Identifies the backend and residue layout, so that saved fingerprints are only read back by a compatible build.
+*/
+#define KARP_RABIN_BACKEND 0
 
 /*
     mpz_equals
@@ -22,7 +683,7 @@
         1 if x == y
         0 otherwise
 */
-inline int mpz_equals(mpz_t x, mpz_t y) {
+static inline int mpz_equals(mpz_t x, mpz_t y) {
     return ((x->_mp_size == y->_mp_size) && mpn_cmp(x->_mp_d, y->_mp_d, x->_mp_size) == 0);
 }
 
@@ -37,57 +698,113 @@ inline int mpz_equals(mpz_t x, mpz_t y) {
         -1 if x < y
         0 otherwise
 */
-inline int compare(mpz_t x, mpz_t y) {
+static inline int compare(mpz_t x, mpz_t y) {
     if (x->_mp_size > y->_mp_size) return 1;
     else if (y->_mp_size > x->_mp_size) return -1;
     else return mpn_cmp(x->_mp_d, y->_mp_d, x->_mp_size);
 }
 
+typedef mpz_t residue;
+
+#define residue_init(x) mpz_init(x)
+#define residue_init_set_ui(x, v) mpz_init_set_ui(x, v)
+#define residue_clear(x) mpz_clear(x)
+#define residue_set(to, from) mpz_set(to, from)
+#define residue_set_ui(x, v) mpz_set_ui(x, v)
+#define residue_equals(x, y) mpz_equals(x, y)
+#define residue_mul(printer, x, y, z) (mpz_mul(x, y, z), mpz_mod(x, x, (printer)->p))
+#define residue_addmul_ui(printer, x, y, v) (mpz_addmul_ui(x, y, v), mpz_mod(x, x, (printer)->p))
+#define residue_submul_ui(printer, x, y, v) (mpz_submul_ui(x, y, v), mpz_mod(x, x, (printer)->p))
+#define residue_add(printer, x, y, z) (mpz_add(x, y, z), (compare(x, (printer)->p) >= 0) ? mpz_sub(x, x, (printer)->p) : (void)0)
+#define residue_add_ui(printer, x, v) (mpz_add_ui(x, x, v), mpz_mod(x, x, (printer)->p))
+#define residue_sub(printer, x, y, z) (mpz_sub(x, y, z), (mpz_sgn(x) < 0) ? mpz_add(x, x, (printer)->p) : (void)0)
+#define residue_pow_ui(printer, x, y, e) mpz_powm_ui(x, y, e, (printer)->p)
+#define residue_invert(printer, x, y) mpz_invert(x, y, (printer)->p)
+
+/*
+    residue_init_at
+    Initialises a residue on caller-owned limbs instead of GMP's allocator.
+    residue_limb_bytes leaves room for an unreduced product, so GMP never reallocates these limbs.
+    Residues initialised this way must not be passed to residue_clear or mpz_swap.
+*/
+#define residue_limb_bytes(printer) (((mpz_size((printer)->p) << 1) + 2) * sizeof(mp_limb_t))
+#define residue_init_at(x, d, bytes) ((x)->_mp_alloc = (bytes) / sizeof(mp_limb_t), (x)->_mp_size = 0, (x)->_mp_d = (mp_limb_t*)(d))
+
 /*
     typedef struct fingerprinter_t *fingerprinter
     Structure to hold numbers for computing fingerprints.
     Components:
-        mpz_t p - Prime number
-        mpz_t r - Random number such that 0 <= r < p
+        mpz_t p        - Prime number
+        mpz_t r        - Random number such that 0 < r < p
+        mpz_t *r_pow2  - r^(2^b) for 0 <= b < bits
+        mpz_t *r_mpow2 - r^-(2^b) for 0 <= b < bits
+        int   bits     - Number of cached powers
 */
 typedef struct fingerprinter_t {
-    mpz_t p, r;
+    mpz_t p, r, *r_pow2, *r_mpow2;
+    int bits;
 } *fingerprinter;
 
+void fingerprinter_extend(fingerprinter printer, int bits);
+
 /*
-    fingerprinter_build
-    Constructs a fingerprint for a problem size and accuracy.
+    fingerprinter_build_from
+    Reconstructs a fingerprinter from its prime and base, for example when loading a saved pattern.
     Parameters:
-        unsigned int n     - Size of the text
-        unsigned int alpha - Desired accuracy
+        residue *p   - Prime number
+        residue *r   - Base such that 0 < r < p
+        int     bits - Number of powers of r to cache
+    Returns fingerprinter:
+        The constructed fingerprint
+*/
+fingerprinter fingerprinter_build_from(residue *p, residue *r, int bits) {
+    fingerprinter printer = malloc(sizeof(struct fingerprinter_t));
+    mpz_init_set(printer->p, *p);
+    mpz_init_set(printer->r, *r);
+
+    printer->r_pow2 = malloc(sizeof(mpz_t));
+    printer->r_mpow2 = malloc(sizeof(mpz_t));
+    mpz_init_set(printer->r_pow2[0], printer->r);
+    mpz_init(printer->r_mpow2[0]);
+    mpz_invert(printer->r_mpow2[0], printer->r, printer->p);
+    printer->bits = 1;
+    fingerprinter_extend(printer, bits);
+
+    return printer;
+}
+
+/*
+    fingerprinter_build_seeded
+    Constructs a fingerprint for a problem size and accuracy from a given seed.
+    Parameters:
+        unsigned int  n     - Size of the text
+        unsigned int  alpha - Desired accuracy
+        unsigned long seed  - Seed for choosing r
     Returns fingerprinter:
         The constructed fingerprint
     Notes:
         Primality is tested using a probabilistic algorithm. For practical purposes it is adequate.
         Chances of a collision are at most 1/n^(1+alpha).
 */
-fingerprinter fingerprinter_build(unsigned int n, unsigned int alpha) {
-    fingerprinter printer = malloc(sizeof(struct fingerprinter_t));
+fingerprinter fingerprinter_build_seeded(unsigned int n, unsigned int alpha, unsigned long seed) {
+    fingerprinter printer;
+    mpz_t p, r;
 
-    mpz_init_set_ui(printer->p, n);
-    mpz_pow_ui(printer->p, printer->p, 2 + alpha);
-    mpz_nextprime(printer->p, printer->p);
+    mpz_init_set_ui(p, n);
+    mpz_pow_ui(p, p, 2 + alpha);
+    mpz_nextprime(p, p);
 
     gmp_randstate_t state;
-    unsigned long seed;
-    size_t seed_len = 0;
-    int f = open("/dev/urandom", O_RDONLY);
-    while (seed_len < sizeof seed) {
-        size_t result = read(f, ((char*)&seed) + seed_len, (sizeof seed) - seed_len);
-        seed_len += result;
-    }
-    close(f);
     gmp_randinit_mt(state);
     gmp_randseed_ui(state, seed);
 
-    mpz_init(printer->r);
-    mpz_urandomm(printer->r, state, printer->p);
+    mpz_init(r);
+    do mpz_urandomm(r, state, p); while (!mpz_sgn(r));
+    gmp_randclear(state);
 
+    printer = fingerprinter_build_from(&p, &r, power_bits(n));
+    mpz_clear(p);
+    mpz_clear(r);
     return printer;
 }
 
@@ -98,21 +815,265 @@ fingerprinter fingerprinter_build(unsigned int n, unsigned int alpha) {
         fingerprinter printer - The fingerprinter to free
 */
 void fingerprinter_free(fingerprinter printer) {
+    int b;
     mpz_clear(printer->p);
     mpz_clear(printer->r);
+    for (b = 0; b < printer->bits; b++) {
+        mpz_clear(printer->r_pow2[b]);
+        mpz_clear(printer->r_mpow2[b]);
+    }
+    free(printer->r_pow2);
+    free(printer->r_mpow2);
     free(printer);
 }
 
+/*
+    residue_horner
+    Fingerprints a string, sum T[i] r^i.
+    Parameters:
+        fingerprinter printer - The printer to use
+        residue       *x      - The residue to set
+        int           *T      - The string
+        unsigned int  l       - The length of the string
+    Returns void:
+        Parameter x modified by reference to the fingerprint of T.
+*/
+void residue_horner(fingerprinter printer, residue *x, int *T, unsigned int l) {
+    int i;
+
+    mpz_set_ui(*x, 0);
+    for (i = l - 1; i >= 0; i--) {
+        mpz_mul(*x, *x, printer->r);
+        mpz_add_ui(*x, *x, T[i]);
+        mpz_mod(*x, *x, printer->p);
+    }
+}
+
+
+/*
+    residue_write
+    Appends a residue to a file in the layout read back by residue_read.
+    Parameters:
+        FILE    *file - The file
+        residue *x    - The residue
+    Returns int:
+        1 on success
+        0 if the write failed
+    Notes:
+        A 64-bit byte count, then the bytes of the number least significant first, padded with zeros to a multiple of 8.
+*/
+int residue_write(FILE *file, residue *x) {
+    uint64_t count = (mpz_sgn(*x)) ? (mpz_sizeinbase(*x, 2) + 7) >> 3 : 0, padded = (count + 7) & ~(uint64_t)7;
+    char *bytes = calloc(padded + 1, 1);
+    int ok;
+    mpz_export(bytes, NULL, -1, 1, 0, 0, *x);
+    ok = (fwrite(&count, sizeof(uint64_t), 1, file) == 1) && (fwrite(bytes, 1, padded, file) == padded);
+    free(bytes);
+    return ok;
+}
+
+/*
+    residue_read
+    Reads a residue written by residue_write.
+    Parameters:
+        const char **data - The next byte to read, advanced past the residue
+        const char *end   - The end of the buffer
+        residue    *x     - The residue to set, which must be initialised
+    Returns int:
+        1 on success
+        0 if the buffer is too short
+    Notes:
+        x may grow to the byte count stored in the file, so read into a residue with its own limbs and check it with
+        residue_reduced before copying it into an arena.
+*/
+int residue_read(const char **data, const char *end, residue *x) {
+    uint64_t count, padded;
+    if (end - *data < (long)sizeof(uint64_t)) return 0;
+    memcpy(&count, *data, sizeof(uint64_t));
+    if (count > (uint64_t)(end - *data) - sizeof(uint64_t)) return 0;
+    padded = (count + 7) & ~(uint64_t)7;
+    if ((uint64_t)(end - *data) - sizeof(uint64_t) < padded) return 0;
+    mpz_import(*x, count, -1, 1, 0, 0, *data + sizeof(uint64_t));
+    *data += sizeof(uint64_t) + padded;
+    return 1;
+}
+
+/*
+    residue_reduced
+    Checks that a residue read from a file is reduced modulo p, and so fits the limbs residue_limb_bytes gives it.
+    Parameters:
+        residue *x - The residue
+        residue *p - The prime
+    Returns int:
+        1 if 0 <= x < p
+        0 otherwise
+*/
+int residue_reduced(residue *x, residue *p) {
+    return (mpz_sgn(*x) >= 0) && (mpz_cmp(*x, *p) < 0);
+}
+
+/*
+    fingerprinter_valid
+    Checks a prime and base read from a file before they are passed to fingerprinter_build_from.
+    Parameters:
+        residue *p - Prime number
+        residue *r - Base
+    Returns int:
+        1 if p is probably prime and 0 < r < p
+        0 otherwise
+*/
+int fingerprinter_valid(residue *p, residue *r) {
+    return (mpz_cmp_ui(*p, 2) > 0) && mpz_probab_prime_p(*p, 25) && (mpz_sgn(*r) > 0) && (mpz_cmp(*r, *p) < 0);
+}
+
+#endif
+
+/*
+    fingerprinter_build
+    Constructs a fingerprint for a problem size and accuracy.
+    Parameters:
+        unsigned int n     - Size of the text
+        unsigned int alpha - Desired accuracy
+    Returns fingerprinter:
+        The constructed fingerprint, seeded from random_seed
+*/
+fingerprinter fingerprinter_build(unsigned int n, unsigned int alpha) {
+    return fingerprinter_build_seeded(n, alpha, random_seed());
+}
+
+/*
+    typedef struct fingerprinter_cache_t fingerprinter_cache
+    List of shared fingerprinters.
+    Components:
+        fingerprinter_cache_t *next    - Next entry
+        unsigned int          bucket  - Smallest power of two at least n, at most 2^31
+        unsigned int          alpha   - Accuracy
+        fingerprinter         printer - The shared fingerprinter
+*/
+typedef struct fingerprinter_cache_t {
+    struct fingerprinter_cache_t *next;
+    unsigned int bucket, alpha;
+    fingerprinter printer;
+} fingerprinter_cache;
+
+fingerprinter_cache *printer_cache = NULL;
+pthread_mutex_t printer_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+    fingerprinter_cached
+    Returns a fingerprinter shared between all calls with n in the same power-of-two bucket and the same alpha.
+    Parameters:
+        unsigned int n     - Size of the text
+        unsigned int alpha - Desired accuracy
+    Returns fingerprinter:
+        A fingerprinter for a text of length at least n, built on first use
+    Notes:
+        Buckets stop at 2^31, which covers every int-indexed text, so larger n share the 2^31 fingerprinter.
+        The cache of powers is filled for every int length, so the result is read-only and safe to share between threads.
+        Do not pass it to fingerprinter_free; see fingerprinter_cache_free.
+*/
+fingerprinter fingerprinter_cached(unsigned int n, unsigned int alpha) {
+    unsigned int bucket = 1;
+    while ((bucket < n) && (bucket < (1U << 31))) bucket <<= 1;
+
+    pthread_mutex_lock(&printer_cache_lock);
+    fingerprinter_cache *entry = printer_cache;
+    while ((entry != NULL) && ((entry->bucket != bucket) || (entry->alpha != alpha))) entry = entry->next;
+    if (entry == NULL) {
+        entry = malloc(sizeof(fingerprinter_cache));
+        entry->bucket = bucket;
+        entry->alpha = alpha;
+        entry->printer = fingerprinter_build(bucket, alpha);
+        fingerprinter_extend(entry->printer, sizeof(int) << 3);
+        entry->next = printer_cache;
+        printer_cache = entry;
+    }
+    pthread_mutex_unlock(&printer_cache_lock);
+    return entry->printer;
+}
+
+/*
+    fingerprinter_cache_free
+    Frees every cached fingerprinter. No fingerprinter returned by fingerprinter_cached may be in use.
+*/
+void fingerprinter_cache_free() {
+    pthread_mutex_lock(&printer_cache_lock);
+    while (printer_cache != NULL) {
+        fingerprinter_cache *next = printer_cache->next;
+        fingerprinter_free(printer_cache->printer);
+        free(printer_cache);
+        printer_cache = next;
+    }
+    pthread_mutex_unlock(&printer_cache_lock);
+}
+
+/*
+    fingerprinter_extend
+    Lazily extends the cache of powers r^(2^b) and r^-(2^b).
+    Parameters:
+        fingerprinter printer - The printer to extend
+        int           bits    - The number of powers required
+    Returns void:
+        Parameter printer modified by reference so that lengths below 2^bits can be composed from the cache.
+*/
+void fingerprinter_extend(fingerprinter printer, int bits) {
+    if (bits <= printer->bits) return;
+    printer->r_pow2 = realloc(printer->r_pow2, bits * sizeof(residue));
+    printer->r_mpow2 = realloc(printer->r_mpow2, bits * sizeof(residue));
+    for (; printer->bits < bits; printer->bits++) {
+        residue_init(printer->r_pow2[printer->bits]);
+        residue_init(printer->r_mpow2[printer->bits]);
+        residue_mul(printer, printer->r_pow2[printer->bits], printer->r_pow2[printer->bits - 1], printer->r_pow2[printer->bits - 1]);
+        residue_mul(printer, printer->r_mpow2[printer->bits], printer->r_mpow2[printer->bits - 1], printer->r_mpow2[printer->bits - 1]);
+    }
+}
+
+/*
+    power_mul
+    Multiplies a residue by r^k using the cached powers of two.
+    Parameters:
+        fingerprinter printer - The printer to use
+        residue       *x      - The residue to multiply
+        int           k       - The exponent, k >= 0
+    Returns void:
+        Parameter x modified by reference to x * r^k
+*/
+void power_mul(fingerprinter printer, residue *x, int k) {
+    int b;
+    for (b = 0; k; b++, k >>= 1) {
+        if (b == printer->bits) fingerprinter_extend(printer, b + 1);
+        if (k & 1) residue_mul(printer, *x, *x, printer->r_pow2[b]);
+    }
+}
+
+/*
+    power_mul_inverse
+    Multiplies a residue by r^-k using the cached powers of two.
+    Parameters:
+        fingerprinter printer - The printer to use
+        residue       *x      - The residue to multiply
+        int           k       - The exponent, k >= 0
+    Returns void:
+        Parameter x modified by reference to x * r^-k
+*/
+void power_mul_inverse(fingerprinter printer, residue *x, int k) {
+    int b;
+    for (b = 0; k; b++, k >>= 1) {
+        if (b == printer->bits) fingerprinter_extend(printer, b + 1);
+        if (k & 1) residue_mul(printer, *x, *x, printer->r_mpow2[b]);
+    }
+}
+
 /*
     typedef struct fingerprint_t *fingerprint
     Structure to hold fingerprints.
     Components:
-        mpz_t finger - The fingerprint itself
-        mpz_t r_k    - r^k, where k = ceiling(log_p(finger))
-        mpz_t r_mk   - r^-k
+        residue finger - The fingerprint itself
+        int     k      - The length of the fingerprinted string
 */
 typedef struct fingerprint_t {
-    mpz_t finger, r_k, r_mk;
+    residue finger;
+    int k;
 } *fingerprint;
 
 /*
@@ -120,13 +1081,12 @@ typedef struct fingerprint_t {
     Constructs an empty fingerprint.
     Returns fingerprint:
         finger = 0
-        r^k = r^mk = 1
+        k = 0
 */
 fingerprint init_fingerprint() {
     fingerprint finger = malloc(sizeof(struct fingerprint_t));
-    mpz_init(finger->finger);
-    mpz_init_set_ui(finger->r_k, 1);
-    mpz_init_set_ui(finger->r_mk, 1);
+    residue_init(finger->finger);
+    finger->k = 0;
     return finger;
 }
 
@@ -142,20 +1102,8 @@ fingerprint init_fingerprint() {
         Parameter print modified by reference to new fingerprint.
 */
 void set_fingerprint(fingerprinter printer, int *T, unsigned int l, fingerprint print) {
-    mpz_set_ui(print->r_k, 1);
-    int i;
-
-    mpz_set_ui(print->finger, T[0]);
-
-    for (i = 1; i < l; i++) {
-        mpz_mul(print->r_k, print->r_k, printer->r);
-        mpz_addmul_ui(print->finger, print->r_k, T[i]);
-        mpz_mod(print->finger, print->finger, printer->p);
-    }
-    mpz_mul(print->r_k, print->r_k, printer->r);
-    mpz_mod(print->r_k, print->r_k, printer->p);
-
-    mpz_invert(print->r_mk, print->r_k, printer->p);
+    residue_horner(printer, &print->finger, T, l);
+    print->k = l;
 }
 
 /*
@@ -168,9 +1116,8 @@ void set_fingerprint(fingerprinter printer, int *T, unsigned int l, fingerprint
         Parameter to modified by reference to copied fingerprint.
 */
 void fingerprint_assign(fingerprint from, fingerprint to) {
-    mpz_set(to->finger, from->finger);
-    mpz_set(to->r_k, from->r_k);
-    mpz_set(to->r_mk, from->r_mk);
+    residue_set(to->finger, from->finger);
+    to->k = from->k;
 }
 
 /*
@@ -185,14 +1132,10 @@ void fingerprint_assign(fingerprint from, fingerprint to) {
         Parameter v modified by reference to suffix.
 */
 void fingerprint_suffix(fingerprinter printer, fingerprint uv, fingerprint u, fingerprint v) {
-    mpz_mul(v->r_k, uv->r_k, u->r_mk);
-    mpz_mod(v->r_k, v->r_k, printer->p);
-    mpz_invert(v->r_mk, v->r_k, printer->p);
-
-    mpz_sub(v->finger, uv->finger, u->finger);
-    if (mpz_cmp_si(v->finger, 0) < 0) mpz_add(v->finger, v->finger, printer->p);
-    mpz_mul(v->finger, v->finger, u->r_mk);
-    mpz_mod(v->finger, v->finger, printer->p);
+    int u_k = u->k, v_k = uv->k - u->k;
+    residue_sub(printer, v->finger, uv->finger, u->finger);
+    power_mul_inverse(printer, &v->finger, u_k);
+    v->k = v_k;
 }
 
 /*
@@ -205,16 +1148,14 @@ void fingerprint_suffix(fingerprinter printer, fingerprint uv, fingerprint u, fi
         fingerprint u         - The fingerprint prefix
     Returns void:
         Parameter u modified by reference to prefix.
+        u must not be the same fingerprint as uv.
 */
 void fingerprint_prefix(fingerprinter printer, fingerprint uv, fingerprint v, fingerprint u) {
-    mpz_mul(u->r_k, uv->r_k, v->r_mk);
-    mpz_mod(u->r_k, u->r_k, printer->p);
-    mpz_invert(u->r_mk, u->r_k, printer->p);
-
-    mpz_mul(u->finger, v->finger, u->r_k);
-    mpz_mod(u->finger, u->finger, printer->p);
-    mpz_sub(u->finger, uv->finger, u->finger);
-    if (mpz_cmp_si(u->finger, 0) < 0) mpz_add(u->finger, u->finger, printer->p);
+    int u_k = uv->k - v->k;
+    residue_set(u->finger, v->finger);
+    power_mul(printer, &u->finger, u_k);
+    residue_sub(printer, u->finger, uv->finger, u->finger);
+    u->k = u_k;
 }
 
 /*
@@ -227,16 +1168,31 @@ void fingerprint_prefix(fingerprinter printer, fingerprint uv, fingerprint v, fi
         fingerprint uv        - The total fingerprint
     Returns void:
         Parameter uv modified by reference to concatenation.
+        uv must not be the same fingerprint as u or v.
 */
 void fingerprint_concat(fingerprinter printer, fingerprint u, fingerprint v, fingerprint uv) {
-    mpz_mul(uv->r_k, u->r_k, v->r_k);
-    mpz_mod(uv->r_k, uv->r_k, printer->p);
-    mpz_invert(uv->r_mk, uv->r_k, printer->p);
+    residue_set(uv->finger, v->finger);
+    power_mul(printer, &uv->finger, u->k);
+    residue_add(printer, uv->finger, u->finger, uv->finger);
+    uv->k = u->k + v->k;
+}
 
-    mpz_mul(uv->finger, v->finger, u->r_k);
-    mpz_mod(uv->finger, uv->finger, printer->p);
-    mpz_add(uv->finger, u->finger, uv->finger);
-    if (compare(uv->finger, printer->p) > 0) mpz_sub(uv->finger, uv->finger, printer->p);
+/*
+    fingerprint_append
+    Appends a single value to a fingerprint without allocating.
+    Parameters:
+        fingerprinter printer - The printer to use
+        fingerprint   f       - The fingerprint to extend
+        int           t       - The value to append
+        residue       *r_k    - r^k, where k is the length of f
+    Returns void:
+        Parameter f modified by reference to the fingerprint of f followed by t.
+        Parameter r_k modified by reference to r^(k + 1).
+*/
+void fingerprint_append(fingerprinter printer, fingerprint f, int t, residue *r_k) {
+    residue_addmul_ui(printer, f->finger, *r_k, t);
+    residue_mul(printer, *r_k, *r_k, printer->r);
+    f->k++;
 }
 
 /*
@@ -246,15 +1202,14 @@ void fingerprint_concat(fingerprinter printer, fingerprint u, fingerprint v, fin
         fingerprinter printer - The printer to use
         fingerprint   f       - The original fingerprint
         unsigned int  t_z     - The value of T[z] in the text
-        mpz_t         r_z     - r^z
+        residue       *r_z    - r^z
         fingerprint   f_z     - The newly-zeroed fingerprint
     Returns void:
         Parameter f_z modified by reference to the fingerprint with the element at index z set to zero.
 */
-void fingerprint_zero(fingerprinter printer, fingerprint f, int t_z, mpz_t r_z, fingerprint f_z) {
+void fingerprint_zero(fingerprinter printer, fingerprint f, int t_z, residue *r_z, fingerprint f_z) {
     fingerprint_assign(f, f_z);
-    mpz_submul_ui(f_z->finger, r_z, t_z);
-    if (mpz_cmp_si(f_z->finger, 0) < 0) mpz_add(f_z->finger, f_z->finger, printer->p);
+    residue_submul_ui(printer, f_z->finger, *r_z, t_z);
 }
 
 /*
@@ -268,7 +1223,7 @@ void fingerprint_zero(fingerprinter printer, fingerprint f, int t_z, mpz_t r_z,
         0 otherwise
 */
 int fingerprint_equals(fingerprint T_f, fingerprint P_f) {
-    return (mpz_equals(T_f->r_k, P_f->r_k) && mpz_equals(T_f->r_mk, P_f->r_mk) && mpz_equals(T_f->finger, P_f->finger));
+    return ((T_f->k == P_f->k) && residue_equals(T_f->finger, P_f->finger));
 }
 
 /*
@@ -278,10 +1233,129 @@ int fingerprint_equals(fingerprint T_f, fingerprint P_f) {
         fingerprint finger - The fingerprint to free
 */
 void fingerprint_free(fingerprint finger) {
-    mpz_clear(finger->finger);
-    mpz_clear(finger->r_k);
-    mpz_clear(finger->r_mk);
+    residue_clear(finger->finger);
     free(finger);
 }
 
+/*
+    typedef struct fingerprint_arena
+    A single block holding the fingerprints, residues and any other storage used by one match.
+    Components:
+        char   *block - The block
+        size_t size   - The size of the block in bytes
+        size_t used   - The number of bytes handed out so far
+        size_t limbs  - The bytes of limb storage given to each residue
+*/
+typedef struct {
+    char *block;
+    size_t size, used, limbs;
+} fingerprint_arena;
+
+#define ARENA_ALIGN 16
+#define arena_round(bytes) (((bytes) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+/*
+    arena_size
+    Computes the size of an arena large enough for a known number of fingerprints and residues.
+    Parameters:
+        fingerprinter printer      - The printer the fingerprints will be used with
+        int           fingerprints - The number of fingerprints needed
+        int           residues     - The number of stand-alone residues needed
+        size_t        bytes        - Extra bytes for arena_alloc, each request rounded with arena_round
+    Returns size_t:
+        The size of the block, a multiple of ARENA_ALIGN
+*/
+size_t arena_size(fingerprinter printer, int fingerprints, int residues, size_t bytes) {
+    size_t limbs = arena_round(residue_limb_bytes(printer));
+    return fingerprints * (arena_round(sizeof(struct fingerprint_t)) + limbs) + residues * limbs + arena_round(bytes);
+}
+
+/*
+    arena_at
+    Makes an arena out of caller-owned memory.
+    Parameters:
+        fingerprinter printer - The printer the fingerprints will be used with
+        void          *block  - The memory, aligned to ARENA_ALIGN
+        size_t        size    - The size of the block, from arena_size
+    Returns fingerprint_arena:
+        The arena, with nothing yet handed out. Must not be passed to arena_free.
+*/
+fingerprint_arena arena_at(fingerprinter printer, void *block, size_t size) {
+    fingerprint_arena arena;
+    arena.limbs = arena_round(residue_limb_bytes(printer));
+    arena.size = size;
+    arena.used = 0;
+    arena.block = block;
+    return arena;
+}
+
+/*
+    arena_build
+    Allocates an arena large enough for a known number of fingerprints and residues.
+    Parameters:
+        fingerprinter printer      - The printer the fingerprints will be used with
+        int           fingerprints - The number of fingerprints needed
+        int           residues     - The number of stand-alone residues needed
+        size_t        bytes        - Extra bytes for arena_alloc, each request rounded with arena_round
+    Returns fingerprint_arena:
+        The arena, with nothing yet handed out
+*/
+fingerprint_arena arena_build(fingerprinter printer, int fingerprints, int residues, size_t bytes) {
+    size_t size = arena_size(printer, fingerprints, residues, bytes);
+    return arena_at(printer, malloc(size), size);
+}
+
+/*
+    arena_alloc
+    Hands out storage from an arena.
+    Parameters:
+        fingerprint_arena *arena - The arena
+        size_t            bytes  - The number of bytes required
+    Returns void*:
+        Storage aligned to ARENA_ALIGN, valid until arena_free
+*/
+void *arena_alloc(fingerprint_arena *arena, size_t bytes) {
+    void *result = arena->block + arena->used;
+    arena->used += arena_round(bytes);
+    return result;
+}
+
+/*
+    arena_residue
+    Initialises a residue whose limbs live in an arena.
+    Parameters:
+        fingerprint_arena *arena - The arena
+        residue           *x     - The residue to initialise to zero
+*/
+void arena_residue(fingerprint_arena *arena, residue *x) {
+    residue_init_at(*x, arena_alloc(arena, arena->limbs), arena->limbs);
+}
+
+/*
+    arena_fingerprint
+    Constructs an empty fingerprint inside an arena.
+    Parameters:
+        fingerprint_arena *arena - The arena
+    Returns fingerprint:
+        finger = 0
+        k = 0
+        Must not be passed to fingerprint_free.
+*/
+fingerprint arena_fingerprint(fingerprint_arena *arena) {
+    fingerprint finger = arena_alloc(arena, sizeof(struct fingerprint_t));
+    arena_residue(arena, &finger->finger);
+    finger->k = 0;
+    return finger;
+}
+
+/*
+    arena_free
+    Releases an arena and everything handed out from it.
+    Parameters:
+        fingerprint_arena *arena - The arena to free
+*/
+void arena_free(fingerprint_arena *arena) {
+    free(arena->block);
+}
+
 #endif
@@ -5,8 +5,21 @@
 #include <stdlib.h>
 
 void stream_test(char *T, int n, int *P, int m, char *sigma, int s_sigma, int *correct) {
-    mmatch_state state = mmatch_build(P, m, m);
-    int j, pred, *predecessor = malloc(s_sigma * sizeof(int));
+    int k;
+    mmatch_state state = mmatch_build(P, m, m), links = mmatch_build(P, m, m);
+    assert((state.dfa != NULL) == (((long)m * (m + 1)) >> 1 <= MMATCH_DFA_LIMIT));
+    free(links.dfa);
+    links.dfa = NULL;
+    mmatch_rt_state rt_state = mmatch_rt_build(P, m);
+    mmatch_batch batch = mmatch_batch_build(P, m), batch_links = batch;
+    batch_links.dfa = NULL;
+    int lanes[MMATCH_BATCH_LANES], lanes_links[MMATCH_BATCH_LANES], t_preds[MMATCH_BATCH_LANES];
+    unsigned int all = (1U << MMATCH_BATCH_LANES) - 1;
+    for (k = 0; k < MMATCH_BATCH_LANES; k++) {
+        lanes[k] = -1;
+        lanes_links[k] = -1;
+    }
+    int j, pred, matches = 0, *predecessor = malloc(s_sigma * sizeof(int)), *results = malloc((n + m) * sizeof(int));
     for (j = 0; j < s_sigma; j++) predecessor[j] = -1;
     hash_lookup t_pred = hashlookup_build(sigma, predecessor, s_sigma);
     free(predecessor);
@@ -14,13 +27,66 @@ void stream_test(char *T, int n, int *P, int m, char *sigma, int s_sigma, int *c
         pred = hashlookup_search(t_pred, T[j]);
         pred = (pred == -1) ? 0 : j - pred;
         assert(correct[j] == mmatch_stream(&state, pred, j));
+        assert(correct[j] == mmatch_stream(&links, pred, j));
+        matches += mmatch_rt_stream(&rt_state, pred, j, &results[matches]);
+        assert(rt_state.size <= (m >> 1) + 1);
+        for (k = 0; k < MMATCH_BATCH_LANES; k++) t_preds[k] = pred;
+        assert(mmatch_batch_stream(&batch, lanes, t_preds) == ((correct[j] != -1) ? all : 0));
+        assert(mmatch_batch_stream(&batch_links, lanes_links, t_preds) == ((correct[j] != -1) ? all : 0));
         hashlookup_edit(&t_pred, T[j], j);
     }
+    matches += mmatch_rt_finish(&rt_state, &results[matches]);
+    for (j = 0, k = 0; j < n; j++) if (correct[j] != -1) assert((k < matches) && (results[k++] == j));
+    assert(k == matches);
 
     mmatch_free(&state);
+    mmatch_free(&links);
+    mmatch_rt_free(&rt_state);
+    mmatch_batch_free(&batch);
+    free(results);
     hashlookup_free(&t_pred);
 }
 
+void pred_list(char *S, int n, int *pred) {
+    int i, k;
+    for (i = 0; i < n; i++) {
+        for (k = i - 1; (k > -1) && (S[k] != S[i]); k--);
+        pred[i] = (k == -1) ? 0 : i - k;
+    }
+}
+
+void brute_force(char *T, int n, int *P, int m, int *correct) {
+    int i, j, *window = malloc(m * sizeof(int));
+    for (j = 0; j < n; j++) {
+        correct[j] = -1;
+        if (j < m - 1) continue;
+        pred_list(&T[j - m + 1], m, window);
+        for (i = 0; (i < m) && (window[i] == P[i]); i++);
+        if (i == m) correct[j] = j;
+    }
+    free(window);
+}
+
+void periodic_test(void) {
+    int i, m = 400, n = 1200, matches = 0;
+    char *P = malloc(m + 1), *T = malloc(n + 1);
+    int *pattern = malloc(m * sizeof(int)), *correct = malloc(n * sizeof(int));
+    for (i = 0; i < m; i++) P[i] = "aab"[i % 3];
+    for (i = 0; i < n; i++) T[i] = "xxy"[i % 3];
+    T[500] = 'x';
+    T[1000] = 'y';
+    P[m] = T[n] = '\0';
+    pred_list(P, m, pattern);
+    brute_force(T, n, pattern, m, correct);
+    for (i = 0; i < n; i++) matches += (correct[i] != -1);
+    assert(matches > 0);
+    stream_test(T, n, pattern, m, "xy", 2, correct);
+    free(P);
+    free(T);
+    free(pattern);
+    free(correct);
+}
+
 int main(void) {
     int *pattern = malloc(5 * sizeof(int));
     pattern[0] = 0; pattern[1] = 0; pattern[2] = 2; pattern[3] = 2; pattern[4] = 1;
@@ -46,6 +112,8 @@ int main(void) {
     correct[12] = -1; correct[13] = -1; correct[14] = -1; correct[15] = -1; correct[16] = -1; correct[17] = -1;
     stream_test("ababababababababab", 18, pattern, 5, "ab", 2, correct);
 
+    periodic_test();
+
     free(correct);
     free(pattern);
     return 0;
@@ -10,6 +10,18 @@
 #define M_MATCH
 
 #include <stdlib.h>
+#include <string.h>
+
+/*
+    MMATCH_DFA_LIMIT
+    Maximum number of transitions for which mmatch_build precomputes the automaton.
+    Notes:
+        A pattern of length m needs m(m + 1)/2 transitions, so the default allows patterns of up to 361 symbols in 256KB.
+        Define as 0 to always use the failure table. Both give the same matches; the table only trades memory for time.
+*/
+#ifndef MMATCH_DFA_LIMIT
+#define MMATCH_DFA_LIMIT (1 << 16)
+#endif
 
 /*
     compare_pi_tj
@@ -43,115 +55,72 @@ int compare_pi_pj(int i, int j, int i_pred, int j_pred) {
     return ((i_pred == j_pred) || ((i_pred == 0) && (j_pred > i)));
 }
 
-/*
-    typedef struct failure_list_t failure_list
-    Double-Linked List of failure items.
-    Components:
-        failure_list_t *pred   - Predecessor item in the list
-        failure_list_t *succ   - Successor item in the list
-        int            start   - Start of range of indices with this failure value
-        int            failure - Failure value
-*/
-typedef struct failure_list_t {
-    struct failure_list_t *pred, *succ;
-    int start, failure;
-} failure_list;
-
-typedef struct zero_list_t {
-    struct zero_list_t *pred, *succ;
-    int index;
-} zero_list;
-
 /*
     typedef struct mmatch_state
     Structure to hold current state of algorithm.
     Components:
-        int          *k             - Length before predecessor changes from zero
-        int          *c             - Value after predecessor changes
-        int          m              - Length of pattern
-        int          i              - Current index of pattern
-        int          *failure_table - Failure_table table for pattern
-        int          period         - Length of period
-        int          has_break      - Does the period break?
-        int          pred_break     - The predecessor of the character that breaks the period
-        int          failure_break  - The failure value of the character that breaks the period
-        failure_list *failure       - The current index in the failure list
-        failure_list *failure_reset - Pointer to the index in the failure list to reset to if the pattern is not periodic
+        int *p_pred    - Predecessor list for pattern
+        int *failure   - Failure table: length - 1 of the longest proper prefix of P[0:i] that m-matches a suffix
+        int m          - Length of pattern
+        int i          - Current index of pattern
+        int *dfa       - Transition table, or NULL if it would exceed MMATCH_DFA_LIMIT
+        int dfa_reset  - Number of matched symbols after a match when using the transition table
 */
 typedef struct {
-    int *k, *c, m, i, *failure_table, period, has_break, pred_break, failure_break;
-    failure_list *failure, *failure_reset;
-    zero_list *zeros, *zero_reset;
+    int *p_pred, *failure, m, i, *dfa, dfa_reset;
 } mmatch_state;
 
 /*
-    get_pred
-    Returns the predecessor of the character.
+    mmatch_failure
+    Computes the failure table of a pattern.
     Parameters:
-        mmatch_state state - The state of the algorithm
-        int          i     - The index of the pattern
-    Returns int:
-        How long ago was the last time this character occured.
-        0 if this is the first time we've seen the character.
-*/
-int get_pred(mmatch_state state, int i) {
-    if (!state.period) return state.k[i];
-    if ((state.has_break) && (i == state.m - 1)) return state.pred_break;
-    int index = i % state.period;
-    return (i < state.k[index]) ? 0 : state.c[index];
-}
-
-/*
-    get_failure
-    Gets the failure value for integer i.
-    Parameters:
-        mmatch_state *state - The state of the algorithm
-        int          i      - The index of the pattern
-    Returns int:
-        Length of the longest prefix that also p-matches a suffix.
-        Failure list and zero list in parameter state also updated.
+        int *p_pred  - Predecessor list for pattern
+        int m        - Length of pattern
+        int *failure - Array of length m to fill
+    Returns void:
+        Parameter failure modified by reference so that failure[i] + 1 is the length of the longest proper prefix of
+        P[0:i] that m-matches a suffix of it.
 */
-int get_failure(mmatch_state *state, int i) {
-    if (!state->period) return i - state->failure_table[i];
-    if (i == state->m - 1) {
-        i = (state->has_break) ? state->failure_break : i - state->failure->failure;
-        state->failure = state->failure_reset;
-        state->zeros = state->zero_reset;
-        return i;
-    }
-    if (i == state->m - 2) {
-        i -= state->failure->failure;
-        if ((state->failure->pred != NULL) && (i < state->failure->start)) state->failure = state->failure->pred;
-        while ((state->zeros->pred != NULL) && (i <= state->zeros->index)) state->zeros = state->zeros->pred;
-        return i;
-    }
-
-    if ((state->failure->failure > 1) && (state->zeros->index < i) && (state->zeros->index >= state->failure->start) && ((i - state->zeros->index) % state->failure->failure == 0)) {
-        i = state->zeros->index;
-        if (state->zeros->pred != NULL) state->zeros = state->zeros->pred;
-        return i;
+void mmatch_failure(int *p_pred, int m, int *failure) {
+    int i = -1, j;
+    failure[0] = -1;
+    for (j = 1; j < m; j++) {
+        while (i > -1 && !compare_pi_pj(i + 1, j, p_pred[i + 1], p_pred[j])) i = failure[i];
+        if (compare_pi_pj(i + 1, j, p_pred[i + 1], p_pred[j])) i++;
+        failure[j] = i;
     }
-
-    i = i - ((i - state->failure->start) / state->failure->failure + 1) * state->failure->failure;
-    if (state->failure->pred != NULL) state->failure = state->failure->pred;
-    while ((state->zeros->pred != NULL) && (i <= state->zeros->index)) state->zeros = state->zeros->pred;
-    return i;
 }
 
 /*
-    update_failure
-    Updates the failure list.
+    mmatch_dfa
+    Builds the transition table for the first m symbols of a pattern.
     Parameters:
-        mmatch_state *state - The state of the algorithm
-        int          i      - The index of the pattern
+        mmatch_state *state  - The state to add the table to
+        int          *p_pred - Predecessor list for pattern
+        int          m       - Length of pattern
     Returns void:
-        Failure list and zero list in parameter state updated.
+        state->dfa and state->dfa_reset set.
+    Notes:
+        Row q, holding the transitions after q matched symbols, starts at q(q + 1)/2 and has q + 1 columns: a text
+        predecessor t_pred <= q selects column t_pred, and a larger one selects column 0 as the symbol is new to the
+        window. A transition to m signals a match.
 */
-void update_failure(mmatch_state *state, int i) {
-    if (state->period) {
-        if ((state->failure->succ != NULL) && (i >= state->failure->succ->start)) state->failure = state->failure->succ;
-        if ((state->zeros->succ != NULL) && (i > state->zeros->succ->index)) state->zeros = state->zeros->succ;
+void mmatch_dfa(mmatch_state *state, int *p_pred, int m) {
+    int q, c, f, t_pred, *failure = malloc(m * sizeof(int)), *row;
+    mmatch_failure(p_pred, m, failure);
+    state->dfa = malloc((((long)m * (m + 1)) >> 1) * sizeof(int));
+    for (q = 0; q < m; q++) {
+        row = &state->dfa[(q * (q + 1)) >> 1];
+        f = (q) ? failure[q - 1] + 1 : 0;
+        for (c = 0; c <= q; c++) {
+            t_pred = (c) ? c : q + 1;
+            if (compare_pi_tj(q, t_pred, p_pred[q])) row[c] = q + 1;
+            else if (!q) row[c] = 0;
+            else row[c] = state->dfa[((f * (f + 1)) >> 1) + ((c > f) ? 0 : c)];
+        }
     }
+    state->dfa_reset = failure[m - 1] + 1;
+    free(failure);
 }
 
 /*
@@ -163,106 +132,33 @@ void update_failure(mmatch_state *state, int i) {
         int p_len   - Maximum length of pattern
     Returns mmatch_state:
         Initial state for algorithm
+    Notes:
+        If P[0:m - 1] has a period of at most m/2, the prefix is extended while that period continues, up to and including
+        the first symbol that breaks it, or to p_len.
 */
 mmatch_state mmatch_build(int *p_pred, int m, int p_len) {
-    int i, j;
+    int j = m;
     mmatch_state state;
-    state.failure_table = malloc(m * sizeof(int));
-    state.failure_table[0] = 1;
-    state.k = malloc(m * sizeof(int));
-    state.k[0] = 0;
-    i = -1;
-    for (j = 1; j < m; j++) {
-        state.k[j] = p_pred[j];
-        while (i > -1 && !compare_pi_pj(i + 1, j, p_pred[i + 1], p_pred[j])) i -= state.failure_table[i];
-        if (compare_pi_pj(i + 1, j, p_pred[i + 1], p_pred[j])) i++;
-        state.failure_table[j] = j - i;
-    }
-
-    state.has_break = 0;
-    if ((state.failure_table[m - 1] << 1) <= m) {
-        state.period = state.failure_table[m - 1];
-        state.k = realloc(state.k, state.period * sizeof(int));
-        state.c = malloc(state.period * sizeof(int));
-
-        for (j = 0; j < state.period; j++) {
-            i = j;
-            state.c[j] = 0;
-            state.k[j] = 0;
-            while ((i < m) && state.c[j] == 0) {
-                if (p_pred[i] != 0) {
-                    state.c[j] = p_pred[i];
-                    state.k[j] = i;
-                }
-                i += state.period;
-            }
-        }
+    state.failure = malloc(p_len * sizeof(int));
+    mmatch_failure(p_pred, p_len, state.failure);
 
-        state.failure = malloc(sizeof(failure_list));
-        state.failure->failure = 1;
-        state.failure->start = 0;
-        state.failure->pred = NULL;
-        state.failure->succ = NULL;
-        j = 0;
-        while ((j < m) && (state.failure->failure < state.period)) {
-            if (state.failure_table[j] != state.failure->failure) {
-                state.failure->succ = malloc(sizeof(failure_list));
-                state.failure->succ->pred = state.failure;
-                state.failure = state.failure->succ;
-                state.failure->failure = state.failure_table[j];
-                state.failure->start = j;
-                state.failure->succ = NULL;
+    if (((m - 1 - state.failure[m - 1]) << 1) <= m) {
+        while (j < p_len) {
+            if (((j - state.failure[j]) << 1) >= m) {
+                j++;
+                break;
             }
             j++;
         }
-        while ((state.failure->pred != NULL) && (state.failure->pred->start >= i)) state.failure = state.failure->pred;
-
-        state.zeros = malloc(sizeof(zero_list));
-        state.zeros->index = 0;
-        state.zeros->pred = NULL;
-        state.zeros->succ = NULL;
-        for (j = 1; j < m; j++) {
-            if (!p_pred[j]) {
-                state.zeros->succ = malloc(sizeof(zero_list));
-                state.zeros->succ->pred = state.zeros;
-                state.zeros = state.zeros->succ;
-                state.zeros->index = j;
-                state.zeros->succ = NULL;
-            }
-        }
-
-        while ((state.zeros->pred != NULL) && (state.zeros->pred->index >= i)) state.zeros = state.zeros->pred;
-
-        j = m;
-        i = m - 1 - state.failure_table[m - 1];
-        free(state.failure_table);
-        while ((j < p_len) && (!state.has_break)) {
-            while (i > -1 && !compare_pi_pj(i + 1, j, p_pred[i + 1], p_pred[j])) i = get_failure(&state, i);
-            if (compare_pi_pj(i + 1, j, p_pred[i + 1], p_pred[j])) {
-                i++;
-                update_failure(&state, i);
-            }
-            if (((j - i) << 1) >= m) {
-                state.has_break = 1;
-                state.pred_break = p_pred[j];
-                state.failure_break = i;
-            } else if ((state.c[j % state.period] == 0) && (p_pred[j] != 0)) {
-                state.c[j % state.period] = p_pred[j];
-                state.k[j % state.period] = j;
-            }
-            j++;
-        }
-
-        state.failure_reset = state.failure;
-        state.zero_reset = state.zeros;
-
-        while (state.zeros->pred != NULL) state.zeros = state.zeros->pred;
-        while (state.failure->pred != NULL) state.failure = state.failure->pred;
-
-    } else state.period = 0;
+    }
     state.m = j;
     state.i = -1;
+    state.failure = realloc(state.failure, j * sizeof(int));
+    state.p_pred = malloc(j * sizeof(int));
+    memcpy(state.p_pred, p_pred, j * sizeof(int));
 
+    state.dfa = NULL;
+    if (((long)j * (j + 1)) >> 1 <= MMATCH_DFA_LIMIT) mmatch_dfa(&state, p_pred, j);
 
     return state;
 }
@@ -280,14 +176,21 @@ mmatch_state mmatch_build(int *p_pred, int m, int p_len) {
 */
 int mmatch_stream(mmatch_state *state, int t_pred, int j) {
     int i = state->i, result = -1;
-    while (i > -1 && !compare_pi_tj(i + 1, t_pred, get_pred(*state, i + 1))) i = get_failure(state, i);
-    if (compare_pi_tj(i + 1, t_pred, get_pred(*state, i + 1))) {
+    if (state->dfa) {
         i++;
-        update_failure(state, i);
+        i = state->dfa[((i * (i + 1)) >> 1) + ((t_pred > i) ? 0 : t_pred)];
+        if (i == state->m) {
+            state->i = state->dfa_reset - 1;
+            return j;
+        }
+        state->i = i - 1;
+        return -1;
     }
+    while (i > -1 && !compare_pi_tj(i + 1, t_pred, state->p_pred[i + 1])) i = state->failure[i];
+    if (compare_pi_tj(i + 1, t_pred, state->p_pred[i + 1])) i++;
     if (i == state->m - 1) {
         result = j;
-        i = get_failure(state, i);
+        i = state->failure[i];
     }
     state->i = i;
     return result;
@@ -300,24 +203,282 @@ int mmatch_stream(mmatch_state *state, int t_pred, int j) {
         mmatch_state *state - The state to free
 */
 void mmatch_free(mmatch_state *state) {
-    free(state->k);
-    if (state->period) {
-        free(state->c);
-        while (state->zeros->pred != NULL) state->zeros = state->zeros->pred;
-        while (state->zeros->succ != NULL) {
-            state->zeros = state->zeros->succ;
-            free(state->zeros->pred);
-        }
-        free(state->zeros);
-        while (state->failure->pred != NULL) state->failure = state->failure->pred;
-        while (state->failure->succ != NULL) {
-            state->failure = state->failure->succ;
-            free(state->failure->pred);
+    free(state->dfa);
+    free(state->p_pred);
+    free(state->failure);
+}
+
+/*
+    MMATCH_RT_STEPS
+    Number of comparisons the real-time variant performs for each text character.
+    Notes:
+        Every failure step undoes at least one earlier successful comparison, so with two steps per character the
+        backlog of unprocessed characters never exceeds m / 2 + 1.
+*/
+#ifndef MMATCH_RT_STEPS
+#define MMATCH_RT_STEPS 2
+#endif
+
+/*
+    typedef struct mmatch_rt_state
+    Structure to hold the current state of the real-time m-match algorithm.
+    Components:
+        int *p_pred   - Predecessor list for pattern
+        int *failure  - Failure table: length - 1 of the longest proper prefix of P[0:i] that m-matches a suffix
+        int m         - Length of pattern
+        int i         - Current index of pattern
+        int *pending  - Ring buffer of unprocessed characters, as pairs of predecessor and text index
+        int head      - Index of the oldest unprocessed character in the ring buffer
+        int size      - Number of unprocessed characters
+        int capacity  - Capacity of the ring buffer
+*/
+typedef struct {
+    int *p_pred, *failure, m, i, *pending, head, size, capacity;
+} mmatch_rt_state;
+
+/*
+    mmatch_rt_build
+    Creates an initial state for the real-time m-match algorithm.
+    Parameters:
+        int *p_pred - Predecessor list for pattern
+        int m       - Length of pattern
+    Returns mmatch_rt_state:
+        Initial state for algorithm
+*/
+mmatch_rt_state mmatch_rt_build(int *p_pred, int m) {
+    mmatch_rt_state state;
+    state.m = m;
+    state.i = -1;
+    state.p_pred = malloc(m * sizeof(int));
+    state.failure = malloc(m * sizeof(int));
+    memcpy(state.p_pred, p_pred, m * sizeof(int));
+    mmatch_failure(p_pred, m, state.failure);
+
+    state.capacity = m + 1;
+    state.pending = malloc(2 * state.capacity * sizeof(int));
+    state.head = 0;
+    state.size = 0;
+    return state;
+}
+
+/*
+    mmatch_rt_step
+    Performs one comparison against the oldest unprocessed character.
+    Parameters:
+        mmatch_rt_state *state - The current state of the algorithm
+    Returns int:
+        j  if the character consumed at index j completed an m-match
+        -1 otherwise
+*/
+int mmatch_rt_step(mmatch_rt_state *state) {
+    int i = state->i, t_pred = state->pending[state->head << 1], j = state->pending[(state->head << 1) + 1];
+    int result = -1;
+    if (compare_pi_tj(i + 1, t_pred, state->p_pred[i + 1])) i++;
+    else if (i > -1) {
+        state->i = state->failure[i];
+        return -1;
+    }
+    if (++state->head == state->capacity) state->head = 0;
+    state->size--;
+    if (i == state->m - 1) {
+        result = j;
+        i = state->failure[i];
+    }
+    state->i = i;
+    return result;
+}
+
+/*
+    mmatch_rt_stream
+    Queues character T_j and performs at most MMATCH_RT_STEPS comparisons.
+    Parameters:
+        mmatch_rt_state *state   - The current state of the algorithm
+        int             t_pred   - The predecessor of T[j]
+        int             j        - The current index of the text
+        int             *results - Array of at least MMATCH_RT_STEPS elements for the matches found
+    Returns int:
+        Number of matches written to results, in increasing order of their end index.
+        Matches are reported with the same end indices as mmatch_stream, at most m / 2 + 1 characters after the
+        character that ends them. mmatch_rt_finish reports the matches still waiting at the end of the text.
+*/
+int mmatch_rt_stream(mmatch_rt_state *state, int t_pred, int j, int *results) {
+    int tail = state->head + state->size, steps, matches = 0;
+    if (tail >= state->capacity) tail -= state->capacity;
+    state->pending[tail << 1] = t_pred;
+    state->pending[(tail << 1) + 1] = j;
+    state->size++;
+
+    for (steps = 0; (steps < MMATCH_RT_STEPS) && (state->size); steps++) {
+        j = mmatch_rt_step(state);
+        if (j != -1) results[matches++] = j;
+    }
+    return matches;
+}
+
+/*
+    mmatch_rt_finish
+    Processes all characters still waiting in the ring buffer.
+    Parameters:
+        mmatch_rt_state *state   - The current state of the algorithm
+        int             *results - Array of at least m elements for the matches found
+    Returns int:
+        Number of matches written to results, in increasing order of their end index.
+*/
+int mmatch_rt_finish(mmatch_rt_state *state, int *results) {
+    int j, matches = 0;
+    while (state->size) {
+        j = mmatch_rt_step(state);
+        if (j != -1) results[matches++] = j;
+    }
+    return matches;
+}
+
+/*
+    mmatch_rt_free
+    Frees an mmatch_rt_state from memory.
+    Parameters:
+        mmatch_rt_state *state - The state to free
+*/
+void mmatch_rt_free(mmatch_rt_state *state) {
+    free(state->p_pred);
+    free(state->failure);
+    free(state->pending);
+}
+
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif
+
+/*
+    MMATCH_BATCH_LANES
+    Number of streams mmatch_batch_stream advances per call: 16 with AVX-512F, one register of ints, otherwise 8.
+*/
+#ifndef MMATCH_BATCH_LANES
+#ifdef __AVX512F__
+#define MMATCH_BATCH_LANES 16
+#else
+#define MMATCH_BATCH_LANES 8
+#endif
+#endif
+
+/*
+    typedef struct mmatch_batch
+    A pattern prepared for advancing many streams in lock-step. The structure is read-only once built; the state of each
+    stream is a single int, the index of the pattern it has matched up to, which starts at -1.
+    Components:
+        int *p_pred    - Predecessor list for pattern
+        int *failure   - Failure table: length - 1 of the longest proper prefix of P[0:i] that m-matches a suffix
+        int *dfa       - Transition table as built by mmatch_dfa, or NULL if it would exceed MMATCH_DFA_LIMIT
+        int m          - Length of pattern
+        int dfa_reset  - Number of matched symbols after a match when using the transition table
+*/
+typedef struct {
+    int *p_pred, *failure, *dfa, m, dfa_reset;
+} mmatch_batch;
+
+/*
+    mmatch_batch_build
+    Prepares a pattern for mmatch_batch_stream.
+    Parameters:
+        int *p_pred - Predecessor list for pattern
+        int m       - Length of pattern
+    Returns mmatch_batch:
+        The prepared pattern
+*/
+mmatch_batch mmatch_batch_build(int *p_pred, int m) {
+    mmatch_batch batch;
+    mmatch_state tables;
+    batch.m = m;
+    batch.p_pred = malloc(m * sizeof(int));
+    batch.failure = malloc(m * sizeof(int));
+    memcpy(batch.p_pred, p_pred, m * sizeof(int));
+    mmatch_failure(p_pred, m, batch.failure);
+    batch.dfa = NULL;
+    batch.dfa_reset = 0;
+    if (((long)m * (m + 1)) >> 1 <= MMATCH_DFA_LIMIT) {
+        mmatch_dfa(&tables, p_pred, m);
+        batch.dfa = tables.dfa;
+        batch.dfa_reset = tables.dfa_reset;
+    }
+    return batch;
+}
+
+/*
+    mmatch_batch_step
+    Advances one stream by one character, as one lane of mmatch_batch_stream.
+    Parameters:
+        mmatch_batch *batch  - The prepared pattern
+        int          *i      - The state of the stream
+        int          t_pred  - The predecessor of the next character of the stream
+    Returns int:
+        1 if the pattern m-matches the stream ending at this character
+        0 otherwise
+*/
+static inline int mmatch_batch_step(mmatch_batch *batch, int *i, int t_pred) {
+    int q = *i + 1;
+    if (batch->dfa) {
+        q = batch->dfa[((q * (q + 1)) >> 1) + ((t_pred > q) ? 0 : t_pred)];
+        if (q == batch->m) {
+            *i = batch->dfa_reset - 1;
+            return 1;
         }
-        free(state->failure);
-    } else {
-        free(state->failure_table);
+        *i = q - 1;
+        return 0;
+    }
+    q = *i;
+    while (q > -1 && !compare_pi_tj(q + 1, t_pred, batch->p_pred[q + 1])) q = batch->failure[q];
+    if (compare_pi_tj(q + 1, t_pred, batch->p_pred[q + 1])) q++;
+    if (q == batch->m - 1) {
+        *i = batch->failure[q];
+        return 1;
     }
+    *i = q;
+    return 0;
+}
+
+/*
+    mmatch_batch_stream
+    Advances MMATCH_BATCH_LANES independent streams by one character each.
+    Parameters:
+        mmatch_batch *batch  - The prepared pattern
+        int          *i      - The states of the streams
+        const int    *t_pred - The predecessor of the next character of every stream
+    Returns unsigned int:
+        Bit k set if the pattern m-matches stream k ending at its new character
+    Notes:
+        With AVX-512F and a transition table, all 16 lanes take their transition with one gather, and the lanes that
+        complete a match are reset under a mask. Otherwise the lanes run one after another; as they are independent,
+        their loads overlap, which measured faster than AVX2 gathers or than chasing failure links in masked lock-step.
+*/
+unsigned int mmatch_batch_stream(mmatch_batch *batch, int *i, const int *t_pred) {
+    unsigned int k, match = 0;
+#if defined(__AVX512F__) && MMATCH_BATCH_LANES == 16
+    if (batch->dfa) {
+        __m512i one = _mm512_set1_epi32(1), q = _mm512_add_epi32(_mm512_loadu_si512(i), one), t = _mm512_loadu_si512(t_pred);
+        __m512i next = _mm512_srli_epi32(_mm512_mullo_epi32(q, _mm512_add_epi32(q, one)), 1);
+        next = _mm512_add_epi32(next, _mm512_maskz_mov_epi32(_mm512_cmple_epi32_mask(t, q), t));
+        next = _mm512_i32gather_epi32(next, batch->dfa, 4);
+        match = _mm512_cmpeq_epi32_mask(next, _mm512_set1_epi32(batch->m));
+        next = _mm512_mask_mov_epi32(next, (__mmask16)match, _mm512_set1_epi32(batch->dfa_reset));
+        _mm512_storeu_si512(i, _mm512_sub_epi32(next, one));
+        return match;
+    }
+#endif
+    for (k = 0; k < MMATCH_BATCH_LANES; k++) match |= (unsigned int)mmatch_batch_step(batch, &i[k], t_pred[k]) << k;
+    return match;
+}
+
+/*
+    mmatch_batch_free
+    Frees an mmatch_batch from memory.
+    Parameters:
+        mmatch_batch *batch - The prepared pattern to free
+*/
+void mmatch_batch_free(mmatch_batch *batch) {
+    free(batch->p_pred);
+    free(batch->failure);
+    free(batch->dfa);
 }
 
 #endif
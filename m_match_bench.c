@@ -0,0 +1,102 @@
+#include "m_match.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_RUNS 5
+
+/*
+    predecessors
+    Computes how long ago each symbol of a string last occured.
+    Parameters:
+        int *S       - The string
+        int n        - Length of the string
+        int s_sigma  - Size of the alphabet
+        int *pred    - Array of length n to fill
+    Returns void:
+        Parameter pred modified by reference, 0 where the symbol has not occured before.
+*/
+void predecessors(int *S, int n, int s_sigma, int *pred) {
+    int j, *last = malloc(s_sigma * sizeof(int));
+    for (j = 0; j < s_sigma; j++) last[j] = -1;
+    for (j = 0; j < n; j++) {
+        pred[j] = (last[S[j]] == -1) ? 0 : j - last[S[j]];
+        last[S[j]] = j;
+    }
+    free(last);
+}
+
+/*
+    bench
+    Times mmatch_stream and mmatch_rt_stream over a text built from repeating a random period of the pattern, with occasional mutations.
+    mmatch_batch_stream is timed on the same text cut into MMATCH_BATCH_LANES streams. The best of BENCH_RUNS runs is reported.
+    Parameters:
+        int period  - Period of the pattern
+        int m       - Length of the pattern
+        int n       - Length of the text
+        int s_sigma - Size of the alphabet
+*/
+void bench(int period, int m, int n, int s_sigma) {
+    int *P = malloc(m * sizeof(int)), *T = malloc(n * sizeof(int));
+    int *p_pred = malloc(m * sizeof(int)), *t_pred = malloc(n * sizeof(int));
+    int j, k, run, matches = 0, rt_matches = 0, batch_matches = 0, results[MMATCH_RT_STEPS], *rt_results = malloc(m * sizeof(int));
+    int steps = n / MMATCH_BATCH_LANES, *t_lanes = malloc(steps * MMATCH_BATCH_LANES * sizeof(int)), lanes[MMATCH_BATCH_LANES];
+    double ns, best = 0, rt_best = 0, batch_best = 0;
+    for (j = 0; j < m; j++) P[j] = (j < period) ? rand() % s_sigma : P[j - period];
+    for (j = 0; j < n; j++) T[j] = (rand() % 8192) ? P[j % period] : rand() % s_sigma;
+    predecessors(P, m, s_sigma, p_pred);
+    predecessors(T, n, s_sigma, t_pred);
+    for (j = 0; j < steps; j++) for (k = 0; k < MMATCH_BATCH_LANES; k++) t_lanes[j * MMATCH_BATCH_LANES + k] = t_pred[k * steps + j];
+
+    for (run = 0; run < BENCH_RUNS; run++) {
+        mmatch_state state = mmatch_build(p_pred, m, m);
+        struct timespec start, end;
+        matches = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < n; j++) if (mmatch_stream(&state, t_pred[j], j) != -1) matches++;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        if (!run || ns < best) best = ns;
+        mmatch_free(&state);
+
+        mmatch_rt_state rt_state = mmatch_rt_build(p_pred, m);
+        rt_matches = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < n; j++) rt_matches += mmatch_rt_stream(&rt_state, t_pred[j], j, results);
+        rt_matches += mmatch_rt_finish(&rt_state, rt_results);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        if (!run || ns < rt_best) rt_best = ns;
+        mmatch_rt_free(&rt_state);
+
+        mmatch_batch batch = mmatch_batch_build(p_pred, m);
+        for (k = 0; k < MMATCH_BATCH_LANES; k++) lanes[k] = -1;
+        batch_matches = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < steps; j++) batch_matches += __builtin_popcount(mmatch_batch_stream(&batch, lanes, &t_lanes[j * MMATCH_BATCH_LANES]));
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        if (!run || ns < batch_best) batch_best = ns;
+        mmatch_batch_free(&batch);
+    }
+    printf("period = %d, m = %d, sigma = %d: %d matches, %.2f ns/char\n", period, m, s_sigma, matches, best / n);
+    printf("    real-time: %d matches, %.2f ns/char\n", rt_matches, rt_best / n);
+    printf("    %d streams in lock-step: %d matches, %.2f ns/char\n", MMATCH_BATCH_LANES, batch_matches, batch_best / (steps * MMATCH_BATCH_LANES));
+
+    free(rt_results);
+    free(t_lanes);
+    free(P);
+    free(T);
+    free(p_pred);
+    free(t_pred);
+}
+
+int main(void) {
+    srand(1);
+    bench(8, 100, 1 << 24, 4);
+    bench(4, 1000, 1 << 24, 4);
+    bench(50, 1000, 1 << 24, 16);
+    bench(200, 10000, 1 << 24, 64);
+    bench(1000, 1000, 1 << 24, 8);
+    return 0;
+}
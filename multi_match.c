@@ -0,0 +1,74 @@
+#include "multi_match.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    compare_char
+    Compares two characters. Used for the Red/Black Tree
+    Parameters:
+        void* leftp  - First character
+        void* rightp - Second character
+    Returns int:
+        -1 if leftp <  rightp
+         0 if leftp == rightp
+         1 otherwise
+*/
+int compare_char(void* leftp, void* rightp) {
+    char left = (char)(long)leftp;
+    char right = (char)(long)rightp;
+    if (left < right) return -1;
+    else if (left > right) return 1;
+    else return 0;
+}
+
+/*
+    get_char
+    Retrieves the i-th character from string T.
+    Needed due to type conversions.
+    Parameters:
+        void** T - List of elements
+        int i - Index
+    Returns void*:
+        T[i]
+*/
+void* get_char(void** T, int i) {
+    return (void*)(long)((char*)T)[i];
+}
+
+void stream_test(char *T, char **P, int count, int *correct_ids, int *correct_positions, int correct) {
+    int i, k, matches, *m = malloc(count * sizeof(int)), *ids = malloc(correct * sizeof(int)), *positions = malloc(correct * sizeof(int));
+    int n = strlen(T), *found = calloc(n * count, sizeof(int));
+    for (k = 0; k < count; k++) m[k] = strlen(P[k]);
+
+    matches = multi_parameterised_match((void**)T, n, (void***)P, m, count, compare_char, get_char, ids, positions, correct);
+    assert(matches == correct);
+    for (i = 0; i < matches; i++) {
+        assert((i == 0) || (positions[i - 1] <= positions[i]));
+        found[positions[i] * count + ids[i]]++;
+    }
+    for (i = 0; i < correct; i++) assert(found[correct_positions[i] * count + correct_ids[i]] == 1);
+
+    free(found);
+    free(positions);
+    free(ids);
+    free(m);
+}
+
+int main(void) {
+    char *patterns[5] = {"aab", "ab", "aaa", "ba", "abba"};
+    int ids[22]       = {1, 3, 1, 3, 1, 3, 0, 1, 3, 4, 2, 2, 2, 0,  1,  3,  1,  3,  1,  3,  1,  3};
+    int positions[22] = {1, 1, 2, 2, 3, 3, 5, 5, 5, 5, 7, 8, 9, 10, 10, 10, 11, 11, 12, 12, 13, 13};
+    stream_test("ababbaaaaababaa", patterns, 5, ids, positions, 22);
+    stream_test("cdcddcccccdcdcc", patterns, 5, ids, positions, 22);
+
+    char *single[1] = {"ababb"};
+    int single_ids[2] = {0, 0}, single_positions[2] = {4, 14};
+    stream_test("ababbaaaaababaa", single, 1, single_ids, single_positions, 2);
+
+    char *none[2] = {"abcabc", "aaaaaaaa"};
+    stream_test("ababbaaaaababaa", none, 2, NULL, NULL, 0);
+
+    return 0;
+}
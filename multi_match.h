@@ -0,0 +1,239 @@
+/*
+    multi_match.h
+    Parameterised matching of many patterns at once with an Aho-Corasick automaton over predecessor-encoded patterns.
+    More information is available here: http://dx.doi.org/10.1007/3-540-58094-8_19 (Idury and Schaffer, Multiple matching of parameterized patterns)
+    Each pattern is stored as its predecessor list, where the predecessor of P[d] is in the range [0, d]. A text symbol
+    read after d matched symbols has its predecessor clamped to 0 if it exceeds d, as the symbol is new to the window.
+*/
+
+#ifndef MULTI_MATCH
+#define MULTI_MATCH
+
+#include "rbtree.c"
+#include <stdlib.h>
+
+#ifndef ELEMENT_FUNC
+#define ELEMENT_FUNC
+typedef void* (*element_func)(void** T, int i);
+#endif
+
+/*
+    typedef struct multi_node
+    Node of the automaton. Nodes are stored in one array and linked by index, with -1 for none.
+    Components:
+        int child   - First child of the node
+        int sibling - Next child of the parent
+        int label   - Predecessor value on the edge from the parent
+        int depth   - Number of symbols from the root
+        int fail    - Node of the longest proper suffix that is a prefix of some pattern
+        int output  - Nearest node on the failure chain at which a pattern ends
+        int pattern - First pattern ending at this node
+*/
+typedef struct {
+    int child, sibling, label, depth, fail, output, pattern;
+} multi_node;
+
+/*
+    typedef struct multi_match
+    Structure to hold the automaton and the current state of the algorithm.
+    Components:
+        multi_node *nodes        - The nodes, with the root at index 0
+        int        size          - Number of nodes
+        int        state         - The current node
+        int        *next_pattern - Next pattern with the same predecessor list, indexed by pattern
+        int        count         - Number of patterns
+*/
+typedef struct {
+    multi_node *nodes;
+    int size, state, *next_pattern, count;
+} multi_match;
+
+/*
+    multimatch_child
+    Finds the child of a node along an edge.
+    Parameters:
+        multi_match *automaton - The automaton
+        int         node       - The parent
+        int         label      - The predecessor value on the edge
+    Returns int:
+        Index of the child
+        -1 if there is no such child
+*/
+int multimatch_child(multi_match *automaton, int node, int label) {
+    int child = automaton->nodes[node].child;
+    while ((child != -1) && (automaton->nodes[child].label != label)) child = automaton->nodes[child].sibling;
+    return child;
+}
+
+/*
+    multimatch_next
+    Follows the transition from a node for a text predecessor, using failure links where there is no edge.
+    Parameters:
+        multi_match *automaton - The automaton
+        int         node       - The current node
+        int         t_pred     - The predecessor of the text symbol
+    Returns int:
+        The node reached
+*/
+int multimatch_next(multi_match *automaton, int node, int t_pred) {
+    int child;
+    while (1) {
+        child = multimatch_child(automaton, node, (t_pred > automaton->nodes[node].depth) ? 0 : t_pred);
+        if (child != -1) return child;
+        if (!node) return 0;
+        node = automaton->nodes[node].fail;
+    }
+}
+
+/*
+    multimatch_build
+    Constructs the automaton for a set of patterns.
+    Parameters:
+        int **p_preds - Predecessor list of every pattern
+        int *m        - Length of every pattern, at least 1
+        int count     - Number of patterns
+    Returns multi_match:
+        The automaton, in its initial state
+*/
+multi_match multimatch_build(int **p_preds, int *m, int count) {
+    int i, j, node, child, total = 1, head, tail, *queue;
+    multi_match automaton;
+    for (i = 0; i < count; i++) total += m[i];
+    automaton.nodes = malloc(total * sizeof(multi_node));
+    automaton.next_pattern = malloc(count * sizeof(int));
+    automaton.count = count;
+    automaton.state = 0;
+    automaton.size = 1;
+    automaton.nodes[0].child = -1;
+    automaton.nodes[0].sibling = -1;
+    automaton.nodes[0].label = 0;
+    automaton.nodes[0].depth = 0;
+    automaton.nodes[0].fail = 0;
+    automaton.nodes[0].output = -1;
+    automaton.nodes[0].pattern = -1;
+
+    for (i = 0; i < count; i++) {
+        node = 0;
+        for (j = 0; j < m[i]; j++) {
+            child = multimatch_child(&automaton, node, p_preds[i][j]);
+            if (child == -1) {
+                child = automaton.size++;
+                automaton.nodes[child].child = -1;
+                automaton.nodes[child].sibling = automaton.nodes[node].child;
+                automaton.nodes[child].label = p_preds[i][j];
+                automaton.nodes[child].depth = j + 1;
+                automaton.nodes[child].pattern = -1;
+                automaton.nodes[node].child = child;
+            }
+            node = child;
+        }
+        automaton.next_pattern[i] = automaton.nodes[node].pattern;
+        automaton.nodes[node].pattern = i;
+    }
+
+    queue = malloc(automaton.size * sizeof(int));
+    head = 0;
+    tail = 0;
+    for (child = automaton.nodes[0].child; child != -1; child = automaton.nodes[child].sibling) {
+        automaton.nodes[child].fail = 0;
+        automaton.nodes[child].output = -1;
+        queue[tail++] = child;
+    }
+    while (head < tail) {
+        node = queue[head++];
+        for (child = automaton.nodes[node].child; child != -1; child = automaton.nodes[child].sibling) {
+            j = multimatch_next(&automaton, automaton.nodes[node].fail, automaton.nodes[child].label);
+            automaton.nodes[child].fail = j;
+            automaton.nodes[child].output = (automaton.nodes[j].pattern != -1) ? j : automaton.nodes[j].output;
+            queue[tail++] = child;
+        }
+    }
+    free(queue);
+
+    return automaton;
+}
+
+/*
+    multimatch_stream
+    Finds every pattern that p-matches the text ending at T_j.
+    Parameters:
+        multi_match *automaton - The current state of the algorithm
+        int         t_pred     - The predecessor of T[j]
+        int         *ids       - Array of at least count elements for the patterns found
+    Returns int:
+        Number of patterns written to ids
+*/
+int multimatch_stream(multi_match *automaton, int t_pred, int *ids) {
+    int node = multimatch_next(automaton, automaton->state, t_pred), pattern, matches = 0;
+    automaton->state = node;
+    if (automaton->nodes[node].pattern == -1) node = automaton->nodes[node].output;
+    while (node != -1) {
+        for (pattern = automaton->nodes[node].pattern; pattern != -1; pattern = automaton->next_pattern[pattern]) ids[matches++] = pattern;
+        node = automaton->nodes[node].output;
+    }
+    return matches;
+}
+
+/*
+    multimatch_free
+    Frees an automaton from memory.
+    Parameters:
+        multi_match *automaton - The automaton to free
+*/
+void multimatch_free(multi_match *automaton) {
+    free(automaton->nodes);
+    free(automaton->next_pattern);
+}
+
+/*
+    multi_parameterised_match
+    Finds every p-match of a set of patterns in a text, computing the predecessor of each text symbol once.
+    Parameters:
+        void         **T          - The text
+        int          n            - Length of the text
+        void         ***P         - The patterns
+        int          *m           - Length of every pattern, at least 1
+        int          count        - Number of patterns
+        compare_func compare      - Comparison function for symbols
+        element_func get_element  - Function retrieving the i-th symbol of a string
+        int          *ids         - Array for the pattern of every match
+        int          *positions   - Array for the index of the last symbol of every match
+        int          max_results  - Capacity of ids and positions
+    Returns int:
+        Number of matches, in order of position. Only the first max_results are stored.
+*/
+int multi_parameterised_match(void **T, int n, void ***P, int *m, int count, compare_func compare, element_func get_element, int *ids, int *positions, int max_results) {
+    int i, j, k, found, matches = 0, **p_preds = malloc(count * sizeof(int*)), *found_ids = malloc(count * sizeof(int));
+    rbtree pred;
+
+    for (k = 0; k < count; k++) {
+        p_preds[k] = malloc(m[k] * sizeof(int));
+        pred = rbtree_create();
+        for (i = 0; i < m[k]; i++) {
+            p_preds[k][i] = i - (int)(long)rbtree_exchange(pred, get_element(P[k], i), (void*)(long)i, (void*)(long)i, compare);
+        }
+        rbtree_destroy(pred);
+    }
+    multi_match automaton = multimatch_build(p_preds, m, count);
+    for (k = 0; k < count; k++) free(p_preds[k]);
+    free(p_preds);
+
+    pred = rbtree_create();
+    for (i = 0; i < n; i++) {
+        j = i - (int)(long)rbtree_exchange(pred, get_element(T, i), (void*)(long)i, (void*)(long)i, compare);
+        found = multimatch_stream(&automaton, j, found_ids);
+        for (k = 0; k < found; k++, matches++) {
+            if (matches < max_results) {
+                ids[matches] = found_ids[k];
+                positions[matches] = i;
+            }
+        }
+    }
+
+    rbtree_destroy(pred);
+    multimatch_free(&automaton);
+    free(found_ids);
+    return matches;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "open_hash.h"
+#include <assert.h>
+
+int main(void) {
+    int i, j;
+    open_hash table = openhash_build(0);
+    assert(openhash_lookup(&table, 0, -1) == -1);
+    openhash_insert(&table, 0, 7);
+    openhash_insert(&table, UINT64_MAX, 8);
+    assert(openhash_lookup(&table, 0, -1) == 7);
+    assert(openhash_lookup(&table, UINT64_MAX, -1) == 8);
+    assert(openhash_exchange(&table, 0, 9, -1) == 7);
+    assert(openhash_exchange(&table, 1, 10, -1) == -1);
+    assert(openhash_lookup(&table, 0, -1) == 9);
+    assert(openhash_lookup(&table, 1, -1) == 10);
+    assert(table.num == 3);
+    openhash_delete(&table, 0);
+    openhash_delete(&table, 2);
+    assert(openhash_lookup(&table, 0, -1) == -1);
+    assert(openhash_lookup(&table, 1, -1) == 10);
+    assert(openhash_lookup(&table, UINT64_MAX, -1) == 8);
+    assert(table.num == 2);
+    openhash_free(&table);
+
+    table = openhash_build(10);
+    for (i = 0; i < 100000; i++) openhash_insert(&table, (uint64_t)i << 32, i);
+    assert(table.num == 100000);
+    for (i = 0; i < 100000; i++) assert(openhash_lookup(&table, (uint64_t)i << 32, -1) == i);
+    for (i = 0; i < 100000; i += 2) openhash_delete(&table, (uint64_t)i << 32);
+    assert(table.num == 50000);
+    for (i = 0; i < 100000; i++) assert(openhash_lookup(&table, (uint64_t)i << 32, -1) == ((i & 1) ? i : -1));
+    openhash_free(&table);
+
+    int reference[512];
+    for (i = 0; i < 512; i++) reference[i] = -1;
+    table = openhash_build(0);
+    srand(1);
+    for (i = 0; i < 200000; i++) {
+        j = rand() % 512;
+        if (rand() % 3) {
+            assert(openhash_exchange(&table, (uint64_t)j * 1024, i, -1) == reference[j]);
+            reference[j] = i;
+        } else {
+            openhash_delete(&table, (uint64_t)j * 1024);
+            reference[j] = -1;
+        }
+        j = rand() % 512;
+        assert(openhash_lookup(&table, (uint64_t)j * 1024, -1) == reference[j]);
+    }
+    openhash_free(&table);
+
+    return 0;
+}
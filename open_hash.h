@@ -0,0 +1,240 @@
+/*
+    open_hash.h
+    A dictionary from 64-bit keys to integers using open addressing with linear probing.
+    Entries are stored inline in one array, so a lookup usually touches a single cache line. Deletion shifts the following
+    entries of the probe run back instead of leaving tombstones.
+*/
+
+#ifndef OPEN_HASH
+#define OPEN_HASH
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    OPEN_HASH_MIN_BITS
+    Logarithm of the smallest table size.
+*/
+#define OPEN_HASH_MIN_BITS 4
+
+/*
+    typedef struct open_hash_entry
+    Slot of the table.
+    Components:
+        uint64_t key   - The key
+        int      value - The value
+        int      used  - Whether the slot holds an entry
+*/
+typedef struct {
+    uint64_t key;
+    int value, used;
+} open_hash_entry;
+
+/*
+    typedef struct open_hash
+    Structure for holding the pairs.
+    Components:
+        open_hash_entry *entries - The slots, a power of two of them
+        int             bits     - Logarithm of the number of slots
+        int             num      - The number of items
+*/
+typedef struct {
+    open_hash_entry *entries;
+    int bits, num;
+} open_hash;
+
+/*
+    openhash_slot
+    Finds the home slot of a key with Fibonacci hashing.
+    Parameters:
+        open_hash *table - The dictionary
+        uint64_t  key    - The key
+    Returns unsigned int:
+        The first slot to probe for key
+*/
+static inline unsigned int openhash_slot(open_hash *table, uint64_t key) {
+    return (unsigned int)((key * 0x9E3779B97F4A7C15ULL) >> (64 - table->bits));
+}
+
+/*
+    openhash_bits
+    Finds the number of slots used for an expected number of items.
+    Parameters:
+        int num - The number of items expected
+    Returns int:
+        Logarithm of the number of slots, so that num items keep the load factor at most 1/2
+*/
+int openhash_bits(int num) {
+    int bits = OPEN_HASH_MIN_BITS;
+    while ((1 << bits) < (num << 1)) bits++;
+    return bits;
+}
+
+/*
+    openhash_bytes
+    Size of the slots of a table built for an expected number of items.
+    Parameters:
+        int num - The number of items expected
+    Returns size_t:
+        The bytes openhash_build_at needs
+*/
+size_t openhash_bytes(int num) {
+    return ((size_t)1 << openhash_bits(num)) * sizeof(open_hash_entry);
+}
+
+/*
+    openhash_build_at
+    Constructs an empty open_hash object whose slots live in caller-owned memory.
+    Parameters:
+        int  num    - The number of items expected
+        void *slots - openhash_bytes(num) bytes for the slots, or NULL to allocate them
+    Returns open_hash:
+        The constructed dictionary
+    Notes:
+        Caller-owned slots must never need to grow, so at most num items may be added, and openhash_free must not be called.
+*/
+open_hash openhash_build_at(int num, void *slots) {
+    open_hash table;
+    table.bits = openhash_bits(num);
+    if (slots == NULL) table.entries = calloc(1 << table.bits, sizeof(open_hash_entry));
+    else table.entries = memset(slots, 0, openhash_bytes(num));
+    table.num = 0;
+    return table;
+}
+
+/*
+    openhash_build
+    Constructs an empty open_hash object.
+    Parameters:
+        int num - The number of items expected
+    Returns open_hash:
+        The constructed dictionary
+*/
+open_hash openhash_build(int num) {
+    return openhash_build_at(num, NULL);
+}
+
+/*
+    openhash_find
+    Finds the slot holding a key, or the empty slot where it would be inserted.
+    Parameters:
+        open_hash *table - The dictionary
+        uint64_t  key    - The key
+    Returns unsigned int:
+        Index of the slot
+*/
+static inline unsigned int openhash_find(open_hash *table, uint64_t key) {
+    unsigned int mask = (1U << table->bits) - 1, i = openhash_slot(table, key);
+    while ((table->entries[i].used) && (table->entries[i].key != key)) i = (i + 1) & mask;
+    return i;
+}
+
+/*
+    openhash_grow
+    Doubles the number of slots and reinserts every entry.
+    Parameters:
+        open_hash *table - The dictionary
+    Returns void:
+        Parameter table modified by reference.
+*/
+void openhash_grow(open_hash *table) {
+    open_hash_entry *entries = table->entries;
+    unsigned int i, size = 1U << table->bits;
+    table->bits++;
+    table->entries = calloc(size << 1, sizeof(open_hash_entry));
+    for (i = 0; i < size; i++) if (entries[i].used) table->entries[openhash_find(table, entries[i].key)] = entries[i];
+    free(entries);
+}
+
+/*
+    openhash_lookup
+    Searches the dictionary for the corresponding value to a key.
+    Parameters:
+        open_hash *table - The dictionary
+        uint64_t  key    - The key
+        int       def    - Value to return if key is absent
+    Returns int:
+        The value of key
+        def if key is not in the dictionary
+*/
+int openhash_lookup(open_hash *table, uint64_t key, int def) {
+    unsigned int i = openhash_find(table, key);
+    return (table->entries[i].used) ? table->entries[i].value : def;
+}
+
+/*
+    openhash_exchange
+    Sets the value of a key and returns its previous value, probing the table once.
+    Parameters:
+        open_hash *table - The dictionary
+        uint64_t  key    - The key
+        int       value  - The new value
+        int       def    - Value to return if key was absent
+    Returns int:
+        The previous value of key
+        def if key was not in the dictionary
+*/
+int openhash_exchange(open_hash *table, uint64_t key, int value, int def) {
+    unsigned int i = openhash_find(table, key);
+    int old = def;
+    if (table->entries[i].used) old = table->entries[i].value;
+    else {
+        if (((table->num + 1) << 1) > (1 << table->bits)) {
+            openhash_grow(table);
+            i = openhash_find(table, key);
+        }
+        table->entries[i].key = key;
+        table->entries[i].used = 1;
+        table->num++;
+    }
+    table->entries[i].value = value;
+    return old;
+}
+
+/*
+    openhash_insert
+    Sets the value of a key, adding the key if necessary.
+    Parameters:
+        open_hash *table - The dictionary
+        uint64_t  key    - The key
+        int       value  - The value
+*/
+void openhash_insert(open_hash *table, uint64_t key, int value) {
+    openhash_exchange(table, key, value, 0);
+}
+
+/*
+    openhash_delete
+    Removes a key from the dictionary.
+    Parameters:
+        open_hash *table - The dictionary
+        uint64_t  key    - The key
+    Returns void:
+        Later entries of the probe run are shifted back so no lookup passes over an empty slot.
+*/
+void openhash_delete(open_hash *table, uint64_t key) {
+    unsigned int mask = (1U << table->bits) - 1, i = openhash_find(table, key), j, home;
+    if (!table->entries[i].used) return;
+    for (j = (i + 1) & mask; table->entries[j].used; j = (j + 1) & mask) {
+        home = openhash_slot(table, table->entries[j].key);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            table->entries[i] = table->entries[j];
+            i = j;
+        }
+    }
+    table->entries[i].used = 0;
+    table->num--;
+}
+
+/*
+    openhash_free
+    Frees an open_hash object from memory.
+    Parameters:
+        open_hash *table - The dictionary to free
+*/
+void openhash_free(open_hash *table) {
+    free(table->entries);
+}
+
+#endif
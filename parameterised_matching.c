@@ -1,6 +1,8 @@
+#define PM_PARALLEL_MIN_CHUNK 16
 #include "parameterised_matching.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
 
 /*
     compare_char
@@ -14,8 +16,8 @@
          1 otherwise
 */
 int compare_char(void* leftp, void* rightp) {
-    char left = (char)leftp;
-    char right = (char)rightp;
+    char left = (char)(long)leftp;
+    char right = (char)(long)rightp;
     if (left < right) return -1;
     else if (left > right) return 1;
     else return 0;
@@ -32,51 +34,238 @@ int compare_char(void* leftp, void* rightp) {
         T[i]
 */
 void* get_char(void** T, int i) {
-    return (void*)((char*)T)[i];
+    return (void*)(long)((char*)T)[i];
+}
+
+/*
+    load_corrupted
+    Overwrites one int of a saved pattern, tries to load it and restores the file.
+    Parameters:
+        const char *path   - The saved pattern
+        long       offset  - Byte offset of the int
+        int        value   - The value to write
+    Returns int:
+        1 if pm_pattern_load rejected the file
+        0 if it loaded
+*/
+int load_corrupted(const char *path, long offset, int value) {
+    FILE *file = fopen(path, "r+b");
+    int old;
+    pm_pattern loaded;
+    if ((file == NULL) || fseek(file, offset, SEEK_SET) || (fread(&old, sizeof(int), 1, file) != 1)) return 0;
+    fseek(file, offset, SEEK_SET);
+    fwrite(&value, sizeof(int), 1, file);
+    fclose(file);
+    loaded = pm_pattern_load(path, compare_char);
+    if (loaded != NULL) pm_pattern_free(loaded);
+    file = fopen(path, "r+b");
+    fseek(file, offset, SEEK_SET);
+    fwrite(&old, sizeof(int), 1, file);
+    fclose(file);
+    return loaded == NULL;
+}
+
+/*
+    corrupt_test
+    Checks that pm_pattern_load rejects a saved pattern after any of its lengths, tables or residues is corrupted.
+    Parameters:
+        pm_pattern pattern - The saved pattern, which must have rows and a transition table
+        const char *path   - The file it was saved to
+    Returns int:
+        1 if every corruption was rejected
+        0 otherwise
+*/
+int corrupt_test(pm_pattern pattern, const char *path) {
+    int ok = 1, mmatch_m = pattern->mmatch.m;
+    long tables = (sizeof(pm_pattern_header) + 7) & ~7L, table = (mmatch_m * sizeof(int) + 7) & ~7L;
+    long dfa = tables + (table << 1), residues = dfa + (((((long)mmatch_m * (mmatch_m + 1)) >> 1) * sizeof(int) + 7) & ~7L);
+    long size, row_sizes = 0, rows = 0;
+    const char *bytes, *data;
+    residue x;
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+    if ((fd == -1) || (fstat(fd, &info) == -1)) return 0;
+    size = info.st_size;
+    bytes = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (bytes == MAP_FAILED) return 0;
+    data = bytes + residues;
+    residue_init(x);
+    if ((residues < size) && residue_read(&data, bytes + size, &x) && residue_read(&data, bytes + size, &x)) {
+        row_sizes = residues + (long)(data - (bytes + residues));
+        rows = row_sizes + (long)((pattern->lm * sizeof(int) + 7) & ~7L);
+    } else ok = 0;
+    residue_clear(x);
+    munmap((void*)bytes, size);
+
+    ok = ok && load_corrupted(path, offsetof(pm_pattern_header, s_sigma), -5);
+    ok = ok && load_corrupted(path, offsetof(pm_pattern_header, s_sigma), pattern->m + 1);
+    ok = ok && load_corrupted(path, offsetof(pm_pattern_header, m), mmatch_m - 1);
+    ok = ok && load_corrupted(path, offsetof(pm_pattern_header, mmatch_m), 0);
+    ok = ok && load_corrupted(path, offsetof(pm_pattern_header, lm), pattern->lm + 1);
+    ok = ok && load_corrupted(path, offsetof(pm_pattern_header, pred_mode), -1);
+    ok = ok && load_corrupted(path, offsetof(pm_pattern_header, dfa_reset), mmatch_m);
+    ok = ok && load_corrupted(path, tables + sizeof(int), 2);
+    ok = ok && load_corrupted(path, tables + table + sizeof(int), 1);
+    ok = ok && load_corrupted(path, dfa + 2 * sizeof(int), 3);
+    ok = ok && load_corrupted(path, residues + sizeof(int), -1);
+    ok = ok && load_corrupted(path, row_sizes, pattern->rows[0]->k + 1);
+    ok = ok && load_corrupted(path, rows + sizeof(int), -1);
+    return ok;
+}
+
+/*
+    modes_agree
+    Runs parameterised_match with every other predecessor mode and compares the matches with those of PRED_RBTREE.
+    Parameters:
+        char *T        - The text
+        char *P        - The pattern
+        int  *expected - The matches found with PRED_RBTREE
+        int  matches   - Number of matches in expected
+    Returns int:
+        1 if every mode finds the same matches
+        0 otherwise
+*/
+int modes_agree(char *T, char *P, int *expected, int matches) {
+    int modes[4] = {PRED_BYTE, PRED_SHORT, PRED_HASH, PRED_WINDOW}, k, found, agree = 1, n = strlen(T);
+    int *results = malloc(n * sizeof(int));
+    for (k = 0; k < 4; k++) {
+        found = parameterised_match((void**)T, n, (void**)P, strlen(P), 0, compare_char, get_char, modes[k], results);
+        if ((found != matches) || memcmp(results, expected, matches * sizeof(int))) agree = 0;
+    }
+    free(results);
+    return agree;
 }
 
 int main(void) {
-    int *results = malloc(100 * sizeof(int)), matches, i;
+    int *results = malloc(100 * sizeof(int)), matches, i, k;
 
-    matches = parameterised_match((void**)"aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", 100, (void**)"aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaa", 65, 0, compare_char, get_char, results);
-    for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
-    if (matches) printf("%d\n", results[matches - 1]);
-    else printf("No matches\n");
+    char *texts[8] = {
+        "aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+        "aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+        "aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaabbaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaabbaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+        "aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaabbbaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaabbbaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+        "aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaaaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaaaaaaabbbbbaaaaabbbbb",
+        "aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbb",
+        "aaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbb",
+        "aaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaaabbbbbbbbbbbbbbaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaaabbbbbbbbbbbbbb"
+    };
+    char *patterns[8] = {
+        "aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaa",
+        "cccccaaaaacccccbbbbbcccccaaaaacccccbbbbbcccccaaaaacccccbbbbbccccc",
+        "aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaabb",
+        "aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaabbb",
+        "aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaa",
+        "aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbb",
+        "aaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbaaaaabbbbb",
+        "aaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaaabbbb"
+    };
+    for (k = 0; k < 8; k++) {
+        matches = parameterised_match((void**)texts[k], strlen(texts[k]), (void**)patterns[k], strlen(patterns[k]), 0, compare_char, get_char, PRED_RBTREE, results);
+        for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
+        if (matches) printf("%d\n", results[matches - 1]);
+        else printf("No matches\n");
+        if (!modes_agree(texts[k], patterns[k], results, matches)) printf("Predecessor modes disagree\n");
+    }
 
-    matches = parameterised_match((void**)"aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", 200, (void**)"cccccaaaaacccccbbbbbcccccaaaaacccccbbbbbcccccaaaaacccccbbbbbccccc", 65, 0, compare_char, get_char, results);
-    for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
-    if (matches) printf("%d\n", results[matches - 1]);
-    else printf("No matches\n");
+    char *random_text = malloc(2001), random_pattern[21];
+    int *random_results = malloc(2000 * sizeof(int));
+    srand(1);
+    for (k = 0; k < 20; k++) {
+        for (i = 0; i < 2000; i++) random_text[i] = 'a' + ((k & 1) ? rand() % 8 : (rand() % 3 != 0) * (1 + rand() % 7));
+        random_text[2000] = '\0';
+        memcpy(random_pattern, &random_text[rand() % 1980], 20);
+        random_pattern[20] = '\0';
+        matches = parameterised_match((void**)random_text, 2000, (void**)random_pattern, 20, 0, compare_char, get_char, PRED_RBTREE, random_results);
+        if (!matches || !modes_agree(random_text, random_pattern, random_results, matches)) printf("Predecessor modes disagree on a random text\n");
+    }
+    free(random_results);
+    free(random_text);
 
-    matches = parameterised_match((void**)"aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaabbaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaabbaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", 200, (void**)"aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaabb", 65, 0, compare_char, get_char, results);
+    char *stream = "aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaaaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaaaaaaabbbbbaaaaabbbbb";
+    pm_pattern pattern = pm_compile((void**)"aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaa", 80, compare_char, get_char, PRED_BYTE, fingerprinter_cached(200, 0));
+    pm_state *state = pm_build(pattern);
+    for (i = 0, matches = 0; stream[i]; i++) if (pm_stream_push(state, (void*)(long)stream[i]) == i) results[matches++] = i;
+    pm_free(state);
     for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
     if (matches) printf("%d\n", results[matches - 1]);
     else printf("No matches\n");
 
-    matches = parameterised_match((void**)"aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaabbbaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaabbbaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", 200, (void**)"aaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaaaaabbbbbaaaaacccccaabbb", 65, 0, compare_char, get_char, results);
-    for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
-    if (matches) printf("%d\n", results[matches - 1]);
-    else printf("No matches\n");
+    int base = INT_MAX - pattern->m - 150, position, limited = 1;
+    state = pm_build(pattern);
+    state->i = base;
+    for (i = 0, k = 0; stream[i]; i++) {
+        if ((position = pm_stream_push(state, (void*)(long)stream[i])) == -1) continue;
+        if ((i < 150) && (k < matches) && (position == base + results[k])) k++;
+        else limited = 0;
+    }
+    while ((k < matches) && (results[k] >= 150)) k++;
+    if (!limited || (k != matches) || !pm_stream_full(state) || (state->i != INT_MAX - pattern->m)) printf("Stream limit not enforced\n");
+    pm_free(state);
 
-    matches = parameterised_match((void**)"aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaaaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaaaaaaabbbbbaaaaabbbbb", 200, (void**)"aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaa", 80, 0, compare_char, get_char, results);
-    for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
-    if (matches) printf("%d\n", results[matches - 1]);
-    else printf("No matches\n");
+    char path[] = "/tmp/parameterised_matchingXXXXXX";
+    close(mkstemp(path));
+    if (pm_pattern_save(pattern, path)) {
+        pm_pattern loaded = pm_pattern_load(path, compare_char);
+        state = pm_build(loaded);
+        for (i = 0, matches = 0; stream[i]; i++) if (pm_stream_push(state, (void*)(long)stream[i]) == i) results[matches++] = i;
+        pm_free(state);
+        pm_pattern_free(loaded);
+        for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
+        if (matches) printf("%d\n", results[matches - 1]);
+        else printf("No matches\n");
+        if (!corrupt_test(pattern, path)) printf("Corrupt pattern loaded\n");
+    } else printf("Could not save pattern\n");
+    unlink(path);
 
-    matches = parameterised_match((void**)"aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbb", 200, (void**)"aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbb", 80, 0, compare_char, get_char, results);
+    size_t bytes = pm_state_bytes(pattern);
+    char *blocks = malloc(3 * bytes);
+    pm_state *states[3];
+    int j, found, agree = 1;
+    for (j = 0; j < 3; j++) states[j] = pm_state_init(pattern, blocks + j * bytes);
+    for (i = 0, matches = 0; stream[i]; i++) {
+        found = pm_stream_push(states[0], (void*)(long)stream[i]);
+        for (j = 1; j < 3; j++) if (pm_stream_push(states[j], (void*)(long)stream[i]) != found) agree = 0;
+        if (found == i) results[matches++] = i;
+    }
+    for (j = 0; j < 3; j++) pm_free(states[j]);
+    free(blocks);
+    if (!agree) printf("Streams disagree\n");
     for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
     if (matches) printf("%d\n", results[matches - 1]);
     else printf("No matches\n");
+    pm_pattern_free(pattern);
 
-    matches = parameterised_match((void**)"aaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbb", 200, (void**)"aaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbaaaaabbbbb", 80, 0, compare_char, get_char, results);
+    matches = parameterised_match_parallel((void**)stream, strlen(stream), (void**)"aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaa", 80, 0, compare_char, get_char, PRED_BYTE, 4, results);
     for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
     if (matches) printf("%d\n", results[matches - 1]);
     else printf("No matches\n");
+    if ((parameterised_match_parallel((void**)stream, strlen(stream), (void**)"aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaa", 80, 0, compare_char, get_char, PRED_BYTE, 0, &results[matches]) != matches) || memcmp(results, &results[matches], matches * sizeof(int))) printf("Parallel match without threads disagrees\n");
 
-    matches = parameterised_match((void**)"aaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaaabbbbbbbbbbbbbbaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaaabbbbbbbbbbbbbb", 200, (void**)"aaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbbbbbbaaaaaaaaaaabbbb", 90, 0, compare_char, get_char, results);
-    for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
-    if (matches) printf("%d\n", results[matches - 1]);
-    else printf("No matches\n");
+    char *wide_pattern = "aaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaabbbbbaaaaaaaaaa";
+    int n = strlen(stream);
+    uint16_t T_16[200], P_16[80];
+    uint32_t T_32[200], P_32[80];
+    uint64_t T_64[200], P_64[80];
+    for (i = 0; i < n; i++) {
+        T_16[i] = stream[i] * 257;
+        T_32[i] = stream[i] * 16777259U;
+        T_64[i] = (uint64_t)stream[i] << 40;
+    }
+    for (i = 0; i < 80; i++) {
+        P_16[i] = (wide_pattern[i] ^ 3) * 257;
+        P_32[i] = (wide_pattern[i] ^ 3) * 16777259U;
+        P_64[i] = (uint64_t)(wide_pattern[i] ^ 3) << 40;
+    }
+    for (j = 0; j < 4; j++) {
+        if (j == 0) matches = parameterised_match_u8((uint8_t*)stream, n, (uint8_t*)wide_pattern, 80, 0, results);
+        else if (j == 1) matches = parameterised_match_u16(T_16, n, P_16, 80, 0, results);
+        else if (j == 2) matches = parameterised_match_u32(T_32, n, P_32, 80, 0, results);
+        else matches = parameterised_match_u64(T_64, n, P_64, 80, 0, results);
+        for (i = 0; i < matches - 1; i++) printf("%d, ", results[i]);
+        if (matches) printf("%d\n", results[matches - 1]);
+        else printf("No matches\n");
+    }
 
     return 0;
 }
\ No newline at end of file
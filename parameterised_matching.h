@@ -1,12 +1,17 @@
 #ifndef PARAMETERISED_MATCHING
 #define PARAMETERISED_MATCHING
 
-#include "rbtree.c"
+#include "predecessor.h"
 #include "karp_rabin.h"
 #include "m_match.h"
 #include <stdlib.h>
 #include <stdio.h>
-#include <gmp.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 typedef struct {
     int location;
@@ -14,18 +19,23 @@ typedef struct {
 } viable_occurance;
 
 typedef struct {
-    int pred, z;
-    mpz_t r_z;
+    int pred, z, due, slot;
+    residue r_z;
 } zero_item;
 
 typedef struct {
-    int row_size, period, count, zero_start, zero_end;
+    int row_size, period, count, zero_start, zero_next, zero_end, zero_limit, zero_window, due, slot, pending_size;
     fingerprint P, period_f;
     viable_occurance VOs[2];
     zero_item *to_zero;
+    int *pending;
+    residue zero_sum;
 } pattern_row;
 
+#ifndef ELEMENT_FUNC
+#define ELEMENT_FUNC
 typedef void* (*element_func)(void** T, int i);
+#endif
 
 void shift_row(fingerprinter printer, pattern_row *P_i, fingerprint tmp) {
     if (P_i->count <= 2) {
@@ -59,129 +69,988 @@ void add_occurance(fingerprinter printer, fingerprint T_f, int location, pattern
     }
 }
 
-int parameterised_match(void **T, int n, void **P, int m, int alpha, compare_func compare, element_func get_element, int *results) {
-    int i, j, k, *predecessor = malloc(m * sizeof(int)), lookup, lm = 0, matches = 0, index, s_sigma = 0;
-    rbtree p_pred = rbtree_create(), t_pred = rbtree_create();
+/*
+    pm_pending_place
+    Moves an entry of the to_zero list of a row to its place in the heap of entries that are not zeroed yet, ordered
+    by the text index from which they are.
+    Parameters:
+        pattern_row *row   - The row
+        int         index  - The entry in to_zero
+        int         pos    - A free position in the heap to start from
+*/
+void pm_pending_place(pattern_row *row, int index, int pos) {
+    zero_item *to_zero = row->to_zero;
+    int *heap = row->pending, child;
+    while ((pos > 0) && (to_zero[index].due < to_zero[heap[(pos - 1) >> 1]].due)) {
+        heap[pos] = heap[(pos - 1) >> 1];
+        to_zero[heap[pos]].slot = pos;
+        pos = (pos - 1) >> 1;
+    }
+    while ((child = (pos << 1) + 1) < row->pending_size) {
+        if ((child + 1 < row->pending_size) && (to_zero[heap[child + 1]].due < to_zero[heap[child]].due)) child++;
+        if (to_zero[heap[child]].due >= to_zero[index].due) break;
+        heap[pos] = heap[child];
+        to_zero[heap[pos]].slot = pos;
+        pos = child;
+    }
+    heap[pos] = index;
+    to_zero[index].slot = pos;
+}
+
+/*
+    pm_zero_drop
+    Removes the oldest entry of the to_zero list of a row, taking it out of the zeroing correction or the heap of
+    pending entries if it was examined.
+    Parameters:
+        fingerprinter printer - The printer to use
+        pattern_row   *row    - The row
+        int           s_sigma - Capacity of to_zero
+*/
+void pm_zero_drop(fingerprinter printer, pattern_row *row, int s_sigma) {
+    zero_item *item = &row->to_zero[row->zero_start];
+    if (row->zero_start == row->zero_next) {
+        if (++row->zero_next == s_sigma) row->zero_next = 0;
+    } else if (item->slot < 0) {
+        residue_submul_ui(printer, row->zero_sum, item->r_z, item->pred);
+    } else {
+        int last = row->pending[--row->pending_size];
+        if (item->slot < row->pending_size) pm_pending_place(row, last, item->slot);
+    }
+    if (++row->zero_start == s_sigma) row->zero_start = 0;
+}
+
+/*
+    pm_zero_enter
+    Adds the entry at the end of the to_zero list of a row, dropping the oldest entry if the list is full.
+    Parameters:
+        fingerprinter printer - The printer to use
+        pattern_row   *row    - The row
+        int           s_sigma - Capacity of to_zero
+    Returns void:
+        The entry, its pred, z and r_z already set, is left for pm_zero_update to examine.
+*/
+void pm_zero_enter(fingerprinter printer, pattern_row *row, int s_sigma) {
+    if (++row->zero_end == s_sigma) row->zero_end = 0;
+    if (row->zero_end == row->zero_start) pm_zero_drop(printer, row, s_sigma);
+}
 
-    for (i = 0; i < m; i++) {
-        predecessor[i] = i - (int)rbtree_lookup(p_pred, get_element(P, i), (void*)i, compare);
-        if (!predecessor[i]) s_sigma++;
-        rbtree_insert(p_pred, get_element(P, i), (void*)i, compare);
+/*
+    pm_zero_update
+    Brings the zeroing correction of a row up to date when one of its viable occurances is due. Entries that leave the
+    window before they are examined never touch the correction.
+    Parameters:
+        fingerprinter printer - The printer to use
+        pattern_row   *row    - The row
+        int           i       - The current text index
+        int           s_sigma - Capacity of to_zero
+    Returns void:
+        zero_sum of row holds the sum of pred * r^z over the entries with i - row_size < z and z - pred + zero_window <= i.
+*/
+void pm_zero_update(fingerprinter printer, pattern_row *row, int i, int s_sigma) {
+    zero_item *item;
+    while ((row->zero_start != row->zero_end) && (row->to_zero[row->zero_start].z <= i - row->row_size)) pm_zero_drop(printer, row, s_sigma);
+    for (; row->zero_next != row->zero_end; row->zero_next = (row->zero_next + 1 == s_sigma) ? 0 : row->zero_next + 1) {
+        item = &row->to_zero[row->zero_next];
+        item->due = item->z - item->pred + row->zero_window;
+        if (item->due <= i) {
+            item->slot = -1;
+            residue_addmul_ui(printer, row->zero_sum, item->r_z, item->pred);
+        } else pm_pending_place(row, row->zero_next, row->pending_size++);
+    }
+    while (row->pending_size && (row->to_zero[row->pending[0]].due <= i)) {
+        item = &row->to_zero[row->pending[0]];
+        item->slot = -1;
+        residue_addmul_ui(printer, row->zero_sum, item->r_z, item->pred);
+        if (--row->pending_size) pm_pending_place(row, row->pending[row->pending_size], 0);
     }
-    rbtree_destroy(p_pred);
+}
 
-    fingerprinter printer = fingerprinter_build(n, alpha);
+/*
+    pm_row_before
+    Orders two rows in the heap of pm_schedule.
+    Parameters:
+        pattern_row *P_i - The pattern rows
+        int         a    - The first row
+        int         b    - The second row
+    Returns int:
+        1 if row a is due before row b, or at the same index and a is the larger row
+        0 otherwise
+*/
+static inline int pm_row_before(pattern_row *P_i, int a, int b) {
+    return (P_i[a].due < P_i[b].due) || ((P_i[a].due == P_i[b].due) && (a > b));
+}
+
+/*
+    pm_schedule
+    Moves a row to its place in the heap of rows with viable occurances. The heap is ordered by the text index at
+    which the oldest occurance of a row is due, and rows due at the same index by decreasing row, the order in which
+    they must be processed.
+    Parameters:
+        pattern_row *P_i  - The pattern rows
+        int         *heap - The row indices in the heap
+        int         *size - Number of rows in the heap
+        int         j     - The row, after its count or oldest occurance changed
+*/
+void pm_schedule(pattern_row *P_i, int *heap, int *size, int j) {
+    int pos = P_i[j].slot, child;
+    if (!P_i[j].count) {
+        if (pos < 0) return;
+        P_i[j].slot = -1;
+        j = heap[--*size];
+        if (pos == *size) return;
+    } else {
+        P_i[j].due = P_i[j].VOs[0].location + P_i[j].row_size;
+        if (pos < 0) pos = (*size)++;
+    }
+    while ((pos > 0) && pm_row_before(P_i, j, heap[(pos - 1) >> 1])) {
+        heap[pos] = heap[(pos - 1) >> 1];
+        P_i[heap[pos]].slot = pos;
+        pos = (pos - 1) >> 1;
+    }
+    while ((child = (pos << 1) + 1) < *size) {
+        if ((child + 1 < *size) && pm_row_before(P_i, heap[child + 1], heap[child])) child++;
+        if (!pm_row_before(P_i, heap[child], j)) break;
+        heap[pos] = heap[child];
+        P_i[heap[pos]].slot = pos;
+        pos = child;
+    }
+    heap[pos] = j;
+    P_i[j].slot = pos;
+}
+
+/*
+    PM_PATTERN_MAGIC
+    First word of a saved pattern: "PMP" and the version of the layout.
+*/
+#define PM_PATTERN_MAGIC 0x02504d50
+
+/*
+    typedef struct pm_pattern_t *pm_pattern
+    A preprocessed pattern. It is never modified after pm_compile or pm_pattern_load, so any number of streams may share
+    it, including from different threads.
+    Components:
+        fingerprinter     printer      - The fingerprinter, with every power cached
+        mmatch_state      mmatch       - The m-match tables for the shortest prefix, in their initial state
+        int               m            - Length of the pattern
+        int               lm           - Number of pattern rows, 0 if the m-match covers the whole pattern
+        int               s_sigma      - Number of distinct symbols in the pattern
+        int               pred_mode    - Predecessor backend for the text, see predecessor.h
+        compare_func      compare      - Comparison function for symbols
+        fingerprint       *rows        - Fingerprint of every pattern row
+        fingerprint_arena arena        - Block holding the row fingerprints
+        int               owns_printer - Whether pm_pattern_free frees the printer
+        void              *map         - The mapped file the m-match tables point into, or NULL if they are allocated
+        size_t            map_size     - Size of the mapping
+*/
+typedef struct pm_pattern_t {
+    fingerprinter printer;
+    mmatch_state mmatch;
+    int m, lm, s_sigma, pred_mode;
+    compare_func compare;
+    fingerprint *rows;
+    fingerprint_arena arena;
+    int owns_printer;
+    void *map;
+    size_t map_size;
+} *pm_pattern;
+
+/*
+    typedef struct pm_pattern_header
+    Start of a saved pattern. It is followed by the m-match tables, the prime and base of the fingerprinter, and the
+    row fingerprints, each section padded to a multiple of 8 bytes so the tables can be used in place once mapped.
+    Components:
+        int magic          - PM_PATTERN_MAGIC
+        int backend        - KARP_RABIN_BACKEND of the build that saved it
+        int m, lm, s_sigma, pred_mode - As in pm_pattern
+        int mmatch_m, dfa_reset - m and dfa_reset of the mmatch_state
+        int dfa            - Whether the transition table is present
+*/
+typedef struct {
+    int magic, backend, m, lm, s_sigma, pred_mode;
+    int mmatch_m, dfa_reset, dfa;
+} pm_pattern_header;
+
+/*
+    pm_row_count
+    Number of pattern rows after an m-match prefix. The first row is as long as the prefix and every row doubles the
+    one before, except the last, which holds the rest of the pattern.
+    Parameters:
+        int j - Length of the m-match prefix, 0 < j <= m
+        int m - Length of the pattern
+    Returns int:
+        Number of rows, 0 if the prefix is the whole pattern
+*/
+int pm_row_count(int j, int m) {
+    int lm;
+    long k;
+    if (j == m) return 0;
+    for (lm = 1, k = j; (k << 2) < m; k <<= 1) lm++;
+    return lm;
+}
+
+/*
+    pm_compile_pred
+    Preprocesses a pattern given as its predecessor list, for matching against any number of streams.
+    Parameters:
+        int           *p_pred_list - Distance from every pattern symbol to its previous occurance, 0 for the first
+        int           m            - Length of the pattern
+        compare_func  compare      - Comparison function for symbols
+        int           pred_mode    - Predecessor backend for the streams, see predecessor.h
+        fingerprinter printer      - The fingerprinter, which must outlive the pattern
+    Returns pm_pattern:
+        The compiled pattern, which keeps no reference to p_pred_list
+*/
+pm_pattern pm_compile_pred(int *p_pred_list, int m, compare_func compare, int pred_mode, fingerprinter printer) {
+    int i, j, lm = 0;
+    pm_pattern pattern = malloc(sizeof(struct pm_pattern_t));
+    fingerprinter_extend(printer, sizeof(int) << 3);
+    pattern->printer = printer;
+    pattern->owns_printer = 0;
+    pattern->map = NULL;
+    pattern->map_size = 0;
+    pattern->compare = compare;
+    pattern->pred_mode = pred_mode;
+    pattern->m = m;
+    pattern->s_sigma = 0;
+    for (i = 0; i < m; i++) if (!p_pred_list[i]) pattern->s_sigma++;
 
     while ((1 << lm) < m) lm++;
 
-    j = 3 * s_sigma * lm;
+    j = 3 * pattern->s_sigma * lm;
     if (j > m) j = m;
-    mmatch_state mmatch = mmatch_build(predecessor, j, m);
+    pattern->mmatch = mmatch_build(p_pred_list, j, m);
+
+    j = pattern->mmatch.m;
+    pattern->lm = lm = pm_row_count(j, m);
+    if (!lm) return pattern;
+
+    pattern->arena = arena_build(printer, lm, 0, arena_round(lm * sizeof(fingerprint)));
+    pattern->rows = arena_alloc(&pattern->arena, lm * sizeof(fingerprint));
+    for (i = 0; i < lm; i++) {
+        pattern->rows[i] = arena_fingerprint(&pattern->arena);
+        set_fingerprint(printer, &p_pred_list[j], (i < lm - 1) ? j : m - j, pattern->rows[i]);
+        if (i < lm - 1) j <<= 1;
+    }
+
+    return pattern;
+}
 
-    j = mmatch.m;
+/*
+    pm_compile
+    Preprocesses a pattern once, for matching against any number of streams.
+    Parameters:
+        void          **P         - The pattern
+        int           m           - Length of the pattern
+        compare_func  compare     - Comparison function for symbols
+        element_func  get_element - Function retrieving the i-th symbol of the pattern
+        int           pred_mode   - Predecessor backend, see predecessor.h
+        fingerprinter printer     - The fingerprinter, which must outlive the pattern
+    Returns pm_pattern:
+        The compiled pattern
+    Notes:
+        The cache of powers of printer is filled for every int length, so matching never modifies it.
+*/
+pm_pattern pm_compile(void **P, int m, compare_func compare, element_func get_element, int pred_mode, fingerprinter printer) {
+    int i, *p_pred_list = malloc(m * sizeof(int));
+    pm_pattern pattern;
+    predecessor p_pred = predecessor_build(pred_mode, compare, m);
+    for (i = 0; i < m; i++) p_pred_list[i] = predecessor_exchange(&p_pred, get_element(P, i), i);
+    predecessor_free(&p_pred);
+    pattern = pm_compile_pred(p_pred_list, m, compare, pred_mode, printer);
+    free(p_pred_list);
+    return pattern;
+}
+
+/*
+    pm_pattern_write
+    Appends a section to a saved pattern, padded with zeros to a multiple of 8 bytes.
+    Parameters:
+        FILE       *file  - The file
+        const void *data  - The section
+        size_t     bytes  - Length of the section
+    Returns int:
+        1 on success
+        0 if the write failed
+*/
+int pm_pattern_write(FILE *file, const void *data, size_t bytes) {
+    static const char zeros[8] = {0};
+    size_t padding = (8 - (bytes & 7)) & 7;
+    return (fwrite(data, 1, bytes, file) == bytes) && (fwrite(zeros, 1, padding, file) == padding);
+}
+
+/*
+    pm_pattern_take
+    Steps over a section of a mapped pattern.
+    Parameters:
+        const char **data - The start of the section, advanced past its padding
+        const char *end   - The end of the mapping
+        long       count  - Number of items in the section
+        size_t     size   - Size of each item
+    Returns void*:
+        The section
+        NULL if count is negative or the mapping is too short
+*/
+void *pm_pattern_take(const char **data, const char *end, long count, size_t size) {
+    const char *section = *data;
+    size_t bytes = count * size;
+    if ((count < 0) || (bytes > (size_t)(end - section))) return NULL;
+    *data += (bytes + 7) & ~(size_t)7;
+    if (*data > end) *data = end;
+    return (void*)section;
+}
+
+/*
+    pm_pattern_header_valid
+    Checks the header of a saved pattern against this build and against the layout pm_compile_pred produces.
+    Parameters:
+        const pm_pattern_header *header  - The header
+        compare_func            compare  - Comparison function given to pm_pattern_load
+    Returns int:
+        1 if the lengths, row count and predecessor backend are consistent
+        0 otherwise
+*/
+int pm_pattern_header_valid(const pm_pattern_header *header, compare_func compare) {
+    if ((header->magic != PM_PATTERN_MAGIC) || (header->backend != KARP_RABIN_BACKEND)) return 0;
+    if ((header->m < 1) || (header->s_sigma < 1) || (header->s_sigma > header->m)) return 0;
+    if ((header->mmatch_m < 1) || (header->mmatch_m > header->m)) return 0;
+    if (header->lm != pm_row_count(header->mmatch_m, header->m)) return 0;
+    if ((header->pred_mode < PRED_RBTREE) || (header->pred_mode > PRED_WINDOW)) return 0;
+    if ((header->pred_mode == PRED_RBTREE) && (compare == NULL)) return 0;
+    return (header->dfa == 0) || (header->dfa == 1);
+}
+
+/*
+    pm_pattern_tables_valid
+    Checks the m-match tables of a saved pattern, so that matching never indexes outside them.
+    Parameters:
+        mmatch_state *mmatch  - The tables
+        int          s_sigma  - Number of distinct symbols in the pattern
+    Returns int:
+        1 if every predecessor, failure link and transition is in range
+        0 otherwise
+*/
+int pm_pattern_tables_valid(mmatch_state *mmatch, int s_sigma) {
+    int q, c, zeros = 0, *row;
+    for (q = 0; q < mmatch->m; q++) {
+        if ((mmatch->p_pred[q] < 0) || (mmatch->p_pred[q] > q)) return 0;
+        if ((mmatch->failure[q] < -1) || (mmatch->failure[q] >= q)) return 0;
+        if (!mmatch->p_pred[q]) zeros++;
+    }
+    if (zeros > s_sigma) return 0;
+    if (mmatch->dfa == NULL) return 1;
+
+    if (mmatch->dfa_reset != mmatch->failure[mmatch->m - 1] + 1) return 0;
+    for (q = 0; q < mmatch->m; q++) {
+        row = &mmatch->dfa[((long)q * (q + 1)) >> 1];
+        for (c = 0; c <= q; c++) if ((row[c] < 0) || (row[c] > q + 1)) return 0;
+    }
+    return 1;
+}
 
-    if (j == m) {
-        for (i = 0; i < n; i++) {
-            lookup = i - (int)rbtree_lookup(t_pred, get_element(T, i), (void*)i, compare);
-            rbtree_insert(t_pred, get_element(T, i), (void*)i, compare);
-            if (mmatch_stream(&mmatch, lookup, i) == i) results[matches++] = i;
+/*
+    pm_pattern_save
+    Saves a compiled pattern so that pm_pattern_load can map it without preprocessing.
+    Parameters:
+        pm_pattern pattern - The pattern
+        const char *path   - The file to write
+    Returns int:
+        1 on success
+        0 if the file could not be written
+    Notes:
+        Values are stored in host byte order; only builds on the same architecture and fingerprint backend can load the file.
+*/
+int pm_pattern_save(pm_pattern pattern, const char *path) {
+    mmatch_state *mmatch = &pattern->mmatch;
+    pm_pattern_header header;
+    int i, ok, *row_sizes;
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return 0;
+
+    memset(&header, 0, sizeof(pm_pattern_header));
+    header.magic = PM_PATTERN_MAGIC;
+    header.backend = KARP_RABIN_BACKEND;
+    header.m = pattern->m;
+    header.lm = pattern->lm;
+    header.s_sigma = pattern->s_sigma;
+    header.pred_mode = pattern->pred_mode;
+    header.mmatch_m = mmatch->m;
+    header.dfa = (mmatch->dfa != NULL);
+    if (header.dfa) header.dfa_reset = mmatch->dfa_reset;
+
+    ok = pm_pattern_write(file, &header, sizeof(pm_pattern_header));
+    ok = ok && pm_pattern_write(file, mmatch->p_pred, mmatch->m * sizeof(int));
+    ok = ok && pm_pattern_write(file, mmatch->failure, mmatch->m * sizeof(int));
+    if (header.dfa) ok = ok && pm_pattern_write(file, mmatch->dfa, (((long)mmatch->m * (mmatch->m + 1)) >> 1) * sizeof(int));
+
+    ok = ok && residue_write(file, &pattern->printer->p) && residue_write(file, &pattern->printer->r);
+    if (pattern->lm) {
+        row_sizes = malloc(pattern->lm * sizeof(int));
+        for (i = 0; i < pattern->lm; i++) row_sizes[i] = pattern->rows[i]->k;
+        ok = ok && pm_pattern_write(file, row_sizes, pattern->lm * sizeof(int));
+        free(row_sizes);
+        for (i = 0; i < pattern->lm; i++) ok = ok && residue_write(file, &pattern->rows[i]->finger);
+    }
+
+    if (fclose(file)) ok = 0;
+    return ok;
+}
+
+/*
+    pm_pattern_load
+    Maps a pattern saved by pm_pattern_save. The m-match tables are used in place, so loading does no preprocessing,
+    only a pass over the file to check it.
+    Parameters:
+        const char   *path   - The file to read
+        compare_func compare - Comparison function for symbols, only used by PRED_RBTREE
+    Returns pm_pattern:
+        The pattern, with its own fingerprinter
+        NULL if the file is missing, truncated, was saved by an incompatible build, or fails pm_pattern_header_valid,
+        pm_pattern_tables_valid or the row checks
+    Notes:
+        Rows must have the lengths pm_compile_pred gives them, and the prime, base and row fingerprints must be reduced.
+        A transition table larger than MMATCH_DFA_LIMIT of this build is skipped in favour of the failure table.
+        A file that passes every check can still have been altered to give wrong matches, but never makes matching
+        read or write outside the pattern and stream.
+*/
+pm_pattern pm_pattern_load(const char *path, compare_func compare) {
+    int i, k, ok, fd = open(path, O_RDONLY), *row_sizes;
+    struct stat info;
+    const char *data, *end;
+    const pm_pattern_header *header;
+    pm_pattern pattern;
+    mmatch_state *mmatch;
+    residue p, r, x;
+    long cells;
+    void *map;
+    if (fd == -1) return NULL;
+    if ((fstat(fd, &info) == -1) || (info.st_size < (off_t)sizeof(pm_pattern_header))) {
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    data = map;
+    end = data + info.st_size;
+    header = pm_pattern_take(&data, end, 1, sizeof(pm_pattern_header));
+    if (!pm_pattern_header_valid(header, compare)) {
+        munmap(map, info.st_size);
+        return NULL;
+    }
+
+    pattern = malloc(sizeof(struct pm_pattern_t));
+    pattern->map = map;
+    pattern->map_size = info.st_size;
+    pattern->m = header->m;
+    pattern->lm = header->lm;
+    pattern->s_sigma = header->s_sigma;
+    pattern->pred_mode = header->pred_mode;
+    pattern->compare = compare;
+    pattern->owns_printer = 1;
+    pattern->printer = NULL;
+
+    mmatch = &pattern->mmatch;
+    memset(mmatch, 0, sizeof(mmatch_state));
+    mmatch->m = header->mmatch_m;
+    mmatch->i = -1;
+    mmatch->p_pred = pm_pattern_take(&data, end, mmatch->m, sizeof(int));
+    mmatch->failure = pm_pattern_take(&data, end, mmatch->m, sizeof(int));
+    ok = (mmatch->p_pred != NULL) && (mmatch->failure != NULL);
+    if (ok && header->dfa) {
+        cells = ((long)mmatch->m * (mmatch->m + 1)) >> 1;
+        mmatch->dfa = pm_pattern_take(&data, end, cells, sizeof(int));
+        mmatch->dfa_reset = header->dfa_reset;
+        ok = (mmatch->dfa != NULL);
+        if (cells > MMATCH_DFA_LIMIT) mmatch->dfa = NULL;
+    }
+    ok = ok && pm_pattern_tables_valid(mmatch, pattern->s_sigma);
+
+    residue_init(p);
+    residue_init(r);
+    if (ok && residue_read(&data, end, &p) && residue_read(&data, end, &r) && fingerprinter_valid(&p, &r)) {
+        pattern->printer = fingerprinter_build_from(&p, &r, sizeof(int) << 3);
+    }
+    residue_clear(p);
+    residue_clear(r);
+
+    if ((pattern->printer != NULL) && (pattern->lm)) {
+        row_sizes = pm_pattern_take(&data, end, pattern->lm, sizeof(int));
+        pattern->arena = arena_build(pattern->printer, pattern->lm, 0, arena_round(pattern->lm * sizeof(fingerprint)));
+        pattern->rows = arena_alloc(&pattern->arena, pattern->lm * sizeof(fingerprint));
+        residue_init(x);
+        for (i = 0, k = mmatch->m; i < pattern->lm; i++) {
+            pattern->rows[i] = arena_fingerprint(&pattern->arena);
+            if ((row_sizes == NULL) || (row_sizes[i] != ((i < pattern->lm - 1) ? k : pattern->m - k))) break;
+            if (!residue_read(&data, end, &x) || !residue_reduced(&x, &pattern->printer->p)) break;
+            residue_set(pattern->rows[i]->finger, x);
+            pattern->rows[i]->k = row_sizes[i];
+            if (i < pattern->lm - 1) k <<= 1;
         }
-        rbtree_destroy(t_pred);
-        mmatch_free(&mmatch);
-        return matches;
-    }
-
-    i = 0;
-    pattern_row *P_i = malloc(lm * sizeof(pattern_row));
-    while ((j << 2) < m) {
-        P_i[i].row_size = j;
-        P_i[i].count = 0;
-        P_i[i].P = init_fingerprint();
-        P_i[i].period_f = init_fingerprint();
-        set_fingerprint(printer, &predecessor[j], j, P_i[i].P);
-        P_i[i].VOs[0].T_f = init_fingerprint();
-        P_i[i].VOs[1].T_f = init_fingerprint();
-        P_i[i].to_zero = malloc(s_sigma * sizeof(zero_item));
-        P_i[i].zero_start = 0;
-        P_i[i].zero_end = 0;
-        for (k = 0; k < s_sigma; k++) mpz_init(P_i[i].to_zero[k].r_z);
-        j <<= 1;
-        i++;
-    }
-    P_i[i].row_size = m - j;
-    P_i[i].count = 0;
-    P_i[i].P = init_fingerprint();
-    P_i[i].period_f = init_fingerprint();
-    set_fingerprint(printer, &predecessor[j], m - j, P_i[i].P);
-    free(predecessor);
-
-    P_i[i].VOs[0].T_f = init_fingerprint();
-    P_i[i].VOs[1].T_f = init_fingerprint();
-    P_i[i].to_zero = malloc(s_sigma * sizeof(zero_item));
-    for (k = 0; k < s_sigma; k++) mpz_init(P_i[i].to_zero[k].r_z);
-    P_i[i].zero_start = 0;
-    P_i[i].zero_end = 0;
-
-    lm = i + 1;
-    P_i = realloc(P_i, lm * sizeof(pattern_row));
-
-    fingerprint T_f = init_fingerprint(), T_cur = init_fingerprint(), T_prev = init_fingerprint(), tmp = init_fingerprint();
-    mpz_t r_z;
-    mpz_init(r_z);
-
-    for (i = 0; i < n; i++) {
-        lookup = i - (int)rbtree_lookup(t_pred, get_element(T, i), (void*)i, compare);
-        rbtree_insert(t_pred, get_element(T, i), (void*)i, compare);
-        set_fingerprint(printer, &lookup, 1, T_cur);
-        fingerprint_concat(printer, T_prev, T_cur, tmp);
-        mpz_set(r_z, T_prev->r_k);
-        fingerprint_assign(tmp, T_prev);
-
-        for (j = lm - 1; j >= 0; j--) {
-            if (lookup > ((j == lm - 1) ? m - P_i[j].row_size: P_i[j].row_size)) {
-                P_i[j].to_zero[P_i[j].zero_end].pred = lookup;
-                P_i[j].to_zero[P_i[j].zero_end].z = i;
-                mpz_set(P_i[j].to_zero[P_i[j].zero_end].r_z, r_z);
-                if (++P_i[j].zero_end == s_sigma) P_i[j].zero_end = 0;
-                if (P_i[j].zero_end == P_i[j].zero_start) if (++P_i[j].zero_start == s_sigma) P_i[j].zero_start = 0;
+        residue_clear(x);
+        if (i < pattern->lm) {
+            arena_free(&pattern->arena);
+            fingerprinter_free(pattern->printer);
+            pattern->printer = NULL;
+        }
+    }
+
+    if (pattern->printer == NULL) {
+        munmap(map, info.st_size);
+        free(pattern);
+        return NULL;
+    }
+    return pattern;
+}
+
+/*
+    pm_pattern_free
+    Frees a pattern from memory. No stream built from it may still be in use.
+    Parameters:
+        pm_pattern pattern - The pattern to free
+*/
+void pm_pattern_free(pm_pattern pattern) {
+    if (pattern->map != NULL) munmap(pattern->map, pattern->map_size);
+    else mmatch_free(&pattern->mmatch);
+    if (pattern->lm) arena_free(&pattern->arena);
+    if (pattern->owns_printer) fingerprinter_free(pattern->printer);
+    free(pattern);
+}
+
+/*
+    typedef struct pm_state
+    Structure to hold the current state of matching a compiled pattern against a stream. The state, its rows and
+    fingerprints and any fixed-size predecessor table share one block of pm_state_bytes bytes, so a stream may be
+    advanced from any thread and needs nothing but its block.
+    Components:
+        fingerprinter     printer - The fingerprinter of the pattern
+        predecessor       t_pred  - Last occurances of the text symbols
+        mmatch_state      mmatch  - The m-match state for the shortest prefix, sharing the tables of the pattern
+        int               m       - Length of the pattern
+        int               lm      - Number of pattern rows, 0 if the m-match covers the whole pattern
+        int               s_sigma - Number of distinct symbols in the pattern
+        int               i       - Index of the next text symbol
+        int               owned   - Whether pm_free frees the block
+        pattern_row       *P_i    - The pattern rows
+        int               *heap   - Rows with viable occurances, see pm_schedule
+        int               heaped  - Number of rows in heap
+        fingerprint       T_f, T_cur, T_prev, tmp - Text fingerprints and scratch space
+        residue           r_z, r_i - r^(i - 1) and r^i
+        fingerprint_arena arena   - The part of the block holding the rows and fingerprints
+*/
+typedef struct {
+    fingerprinter printer;
+    predecessor t_pred;
+    mmatch_state mmatch;
+    int m, lm, s_sigma, i, owned;
+    pattern_row *P_i;
+    int *heap, heaped;
+    fingerprint T_f, T_cur, T_prev, tmp;
+    residue r_z, r_i;
+    fingerprint_arena arena;
+} pm_state;
+
+/*
+    pm_state_arena_bytes
+    Size of the arena of a stream.
+    Parameters:
+        pm_pattern pattern - The pattern
+    Returns size_t:
+        Bytes of the rows, fingerprints and residues of one stream, 0 if the pattern has no rows
+*/
+size_t pm_state_arena_bytes(pm_pattern pattern) {
+    int lm = pattern->lm;
+    if (!lm) return 0;
+    return arena_size(pattern->printer, 3 * lm + 4, lm * (pattern->s_sigma + 1) + 2, arena_round(lm * sizeof(pattern_row)) + arena_round(lm * sizeof(int)) + lm * (arena_round(pattern->s_sigma * sizeof(zero_item)) + arena_round(pattern->s_sigma * sizeof(int))));
+}
+
+/*
+    pm_state_bytes
+    Reports the memory each stream of a pattern needs.
+    Parameters:
+        pm_pattern pattern - The pattern
+    Returns size_t:
+        Size of the block passed to pm_state_init, the same for every stream
+    Notes:
+        PRED_RBTREE and PRED_HASH streams also allocate for every distinct symbol they see; the other modes never allocate.
+*/
+size_t pm_state_bytes(pm_pattern pattern) {
+    return arena_round(sizeof(pm_state)) + pm_state_arena_bytes(pattern) + arena_round(predecessor_bytes(pattern->pred_mode, pattern->m));
+}
+
+/*
+    pm_state_init
+    Starts matching a compiled pattern against a new stream, in caller-owned memory.
+    Parameters:
+        pm_pattern pattern - The pattern, which must outlive the state
+        void       *block  - pm_state_bytes(pattern) bytes aligned to ARENA_ALIGN
+    Returns pm_state*:
+        The initial state, at the start of block and expecting text index 0 next
+*/
+pm_state *pm_state_init(pm_pattern pattern, void *block) {
+    int i, k, lm = pattern->lm;
+    pm_state *state = block;
+    size_t arena_bytes = pm_state_arena_bytes(pattern);
+    char *tables = (char*)block + arena_round(sizeof(pm_state)) + arena_bytes;
+    state->printer = pattern->printer;
+    state->t_pred = predecessor_build_at(pattern->pred_mode, pattern->compare, pattern->m, tables);
+    state->mmatch = pattern->mmatch;
+    state->m = pattern->m;
+    state->lm = lm;
+    state->s_sigma = pattern->s_sigma;
+    state->i = 0;
+    state->owned = 0;
+    if (!lm) return state;
+
+    state->arena = arena_at(state->printer, (char*)block + arena_round(sizeof(pm_state)), arena_bytes);
+
+    state->P_i = arena_alloc(&state->arena, lm * sizeof(pattern_row));
+    state->heap = arena_alloc(&state->arena, lm * sizeof(int));
+    state->heaped = 0;
+    for (i = 0; i < lm; i++) {
+        pattern_row *row = &state->P_i[i];
+        row->P = pattern->rows[i];
+        row->row_size = row->P->k;
+        row->zero_limit = (i == lm - 1) ? state->m - row->row_size : row->row_size;
+        row->zero_window = (i == lm - 1) ? state->m : row->row_size << 1;
+        row->count = 0;
+        row->slot = -1;
+        row->period_f = arena_fingerprint(&state->arena);
+        row->VOs[0].T_f = arena_fingerprint(&state->arena);
+        row->VOs[1].T_f = arena_fingerprint(&state->arena);
+        row->to_zero = arena_alloc(&state->arena, state->s_sigma * sizeof(zero_item));
+        row->zero_start = 0;
+        row->zero_next = 0;
+        row->zero_end = 0;
+        row->pending = arena_alloc(&state->arena, state->s_sigma * sizeof(int));
+        row->pending_size = 0;
+        arena_residue(&state->arena, &row->zero_sum);
+        for (k = 0; k < state->s_sigma; k++) arena_residue(&state->arena, &row->to_zero[k].r_z);
+    }
+
+    state->T_f = arena_fingerprint(&state->arena);
+    state->T_cur = arena_fingerprint(&state->arena);
+    state->T_prev = arena_fingerprint(&state->arena);
+    state->tmp = arena_fingerprint(&state->arena);
+    arena_residue(&state->arena, &state->r_z);
+    arena_residue(&state->arena, &state->r_i);
+    residue_set_ui(state->r_i, 1);
+
+    return state;
+}
+
+/*
+    pm_build
+    Starts matching a compiled pattern against a new stream of unknown length, up to INT_MAX - m symbols.
+    Parameters:
+        pm_pattern pattern - The pattern, which must outlive the state
+    Returns pm_state*:
+        The initial state in a block of its own, expecting text index 0 next
+*/
+pm_state *pm_build(pm_pattern pattern) {
+    pm_state *state = pm_state_init(pattern, malloc(pm_state_bytes(pattern)));
+    state->owned = 1;
+    return state;
+}
+
+/*
+    pm_stream_full
+    Reports whether a stream has taken as many symbols as it can. Text indices are ints and a row may be due up to m
+    symbols ahead, so a stream takes at most INT_MAX - m symbols; pm_stream_step refuses any after that.
+    Parameters:
+        pm_state *state - The current state
+    Returns int:
+        1 if further symbols are refused
+        0 otherwise
+*/
+static inline int pm_stream_full(pm_state *state) {
+    return state->i >= INT_MAX - state->m;
+}
+
+/*
+    pm_stream_step
+    Feeds the next symbol of the text, given as the distance to its previous occurance.
+    Parameters:
+        pm_state *state  - The current state
+        int      lookup  - The distance from T[i] to its previous occurance in the text, 0 if there is none
+    Returns int:
+        i if P p-matches T[i - m + 1:i]
+        -1 otherwise, or if pm_stream_full holds, in which case the symbol is not consumed
+    Notes:
+        A symbol is entered in the to_zero list of every row whose zero_limit its distance exceeds. Row sizes double, so
+        these rows are always a prefix of the rows.
+*/
+static inline int pm_stream_step(pm_state *state, int lookup) {
+    int i = state->i, j, result = -1, lm = state->lm, s_sigma = state->s_sigma;
+    fingerprinter printer = state->printer;
+    pattern_row *P_i = state->P_i;
+
+    if (pm_stream_full(state)) return -1;
+    state->i++;
+
+    if (!lm) return (mmatch_stream(&state->mmatch, lookup, i) == i) ? i : -1;
+
+    residue_set(state->r_z, state->r_i);
+    fingerprint_append(printer, state->T_prev, lookup, &state->r_i);
+
+    for (j = 0; (j < lm) && (lookup > P_i[j].zero_limit); j++) {
+        P_i[j].to_zero[P_i[j].zero_end].pred = lookup;
+        P_i[j].to_zero[P_i[j].zero_end].z = i;
+        residue_set(P_i[j].to_zero[P_i[j].zero_end].r_z, state->r_z);
+        pm_zero_enter(printer, &P_i[j], s_sigma);
+    }
+
+    while (state->heaped && (P_i[j = state->heap[0]].due == i)) {
+        pm_zero_update(printer, &P_i[j], i, s_sigma);
+        fingerprint_assign(state->T_prev, state->T_cur);
+        residue_sub(printer, state->T_cur->finger, state->T_cur->finger, P_i[j].zero_sum);
+        fingerprint_suffix(printer, state->T_cur, P_i[j].VOs[0].T_f, state->T_f);
+        if (fingerprint_equals(P_i[j].P, state->T_f)) {
+            if (j == lm - 1) result = i;
+            else {
+                add_occurance(printer, state->T_prev, P_i[j].VOs[0].location + P_i[j].row_size, &P_i[j + 1], state->tmp);
+                pm_schedule(P_i, state->heap, &state->heaped, j + 1);
             }
-            if ((P_i[j].count > 0) && (i - P_i[j].VOs[0].location == P_i[j].row_size)) {
-                fingerprint_assign(T_prev, T_cur);
-                index = P_i[j].zero_start;
-                fingerprint_assign(T_cur, tmp);
-                while (index != P_i[j].zero_end) {
-                    if (P_i[j].to_zero[index].z <= i - P_i[j].row_size) {
-                        if (++P_i[j].zero_start == s_sigma) P_i[j].zero_start = 0;
-                    } else if (P_i[j].to_zero[index].z - P_i[j].to_zero[index].pred <= i - ((j == lm - 1) ? m : (P_i[j].row_size << 1))) {
-                        fingerprint_zero(printer, T_cur, P_i[j].to_zero[index].pred, P_i[j].to_zero[index].r_z, tmp);
-                    }
-                    if (++index == s_sigma) index = 0;
-                    fingerprint_assign(tmp, T_cur);
-                }
-                fingerprint_suffix(printer, T_cur, P_i[j].VOs[0].T_f, T_f);
-                if (fingerprint_equals(P_i[j].P, T_f)) {
-                    if (j == lm - 1) results[matches++] = i;
-                    else add_occurance(printer, T_prev, P_i[j].VOs[0].location + P_i[j].row_size, &P_i[j + 1], tmp);
-                }
-                shift_row(printer, &P_i[j], tmp);
+        }
+        shift_row(printer, &P_i[j], state->tmp);
+        pm_schedule(P_i, state->heap, &state->heaped, j);
+    }
+    if (mmatch_stream(&state->mmatch, lookup, i) == i) {
+        add_occurance(printer, state->T_prev, i, &P_i[0], state->tmp);
+        pm_schedule(P_i, state->heap, &state->heaped, 0);
+    }
+    return result;
+}
+
+/*
+    pm_stream_push
+    Feeds the next symbol of the text.
+    Parameters:
+        pm_state *state  - The current state
+        void     *symbol - The next symbol T[i]
+    Returns int:
+        i if P p-matches T[i - m + 1:i]
+        -1 otherwise, or once the stream holds INT_MAX - m symbols, see pm_stream_full
+*/
+static inline int pm_stream_push(pm_state *state, void *symbol) {
+    return pm_stream_step(state, predecessor_exchange(&state->t_pred, symbol, state->i));
+}
+
+/*
+    pm_free
+    Frees a pm_state from memory. The pattern is left to the caller, as is the block of a state from pm_state_init.
+    Parameters:
+        pm_state *state - The state to free
+*/
+void pm_free(pm_state *state) {
+    predecessor_free(&state->t_pred);
+    if (state->owned) free(state);
+}
+
+int parameterised_match(void **T, int n, void **P, int m, int alpha, compare_func compare, element_func get_element, int pred_mode, int *results) {
+    int i, matches = 0;
+    pm_pattern pattern = pm_compile(P, m, compare, get_element, pred_mode, fingerprinter_cached(n, alpha));
+    pm_state *state = pm_build(pattern);
+
+    for (i = 0; i < n; i++) if (pm_stream_push(state, get_element(T, i)) == i) results[matches++] = i;
+
+    pm_free(state);
+    pm_pattern_free(pattern);
+    return matches;
+}
+
+/*
+    PM_TYPED
+    Generates the entry points for texts and patterns held as arrays of an integer type:
+        pm_pattern pm_compile_<suffix>(const type *P, int m, fingerprinter printer)
+        int        pm_stream_push_<suffix>(pm_state *state, type symbol)
+        int        parameterised_match_<suffix>(const type *T, int n, const type *P, int m, int alpha, int *results)
+    They behave as pm_compile, pm_stream_push and parameterised_match, but read the symbols directly and fix the
+    predecessor backend at compile time, so the loop over the text inlines without callbacks. States of a pattern from
+    pm_compile_<suffix> must be fed through pm_stream_push_<suffix>.
+    Parameters:
+        suffix   - Suffix of the generated names
+        type     - The symbol type
+        mode     - Predecessor backend, PRED_BYTE, PRED_SHORT or PRED_HASH
+        exchange - Typed update of the backend, predecessor_exchange_index or predecessor_exchange_key
+*/
+#define PM_TYPED(suffix, type, mode, exchange) \
+pm_pattern pm_compile_##suffix(const type *P, int m, fingerprinter printer) { \
+    int i, *p_pred_list = malloc(m * sizeof(int)); \
+    pm_pattern pattern; \
+    predecessor p_pred = predecessor_build(mode, NULL, m); \
+    for (i = 0; i < m; i++) p_pred_list[i] = exchange(&p_pred, P[i], i); \
+    predecessor_free(&p_pred); \
+    pattern = pm_compile_pred(p_pred_list, m, NULL, mode, printer); \
+    free(p_pred_list); \
+    return pattern; \
+} \
+\
+static inline int pm_stream_push_##suffix(pm_state *state, type symbol) { \
+    return pm_stream_step(state, exchange(&state->t_pred, symbol, state->i)); \
+} \
+\
+int parameterised_match_##suffix(const type *T, int n, const type *P, int m, int alpha, int *results) { \
+    int i, matches = 0; \
+    pm_pattern pattern = pm_compile_##suffix(P, m, fingerprinter_cached(n, alpha)); \
+    pm_state *state = pm_build(pattern); \
+    for (i = 0; i < n; i++) if (pm_stream_push_##suffix(state, T[i]) == i) results[matches++] = i; \
+    pm_free(state); \
+    pm_pattern_free(pattern); \
+    return matches; \
+}
+
+PM_TYPED(u8, uint8_t, PRED_BYTE, predecessor_exchange_index)
+PM_TYPED(u16, uint16_t, PRED_SHORT, predecessor_exchange_index)
+PM_TYPED(u32, uint32_t, PRED_HASH, predecessor_exchange_key)
+PM_TYPED(u64, uint64_t, PRED_HASH, predecessor_exchange_key)
+
+
+/*
+    PM_PARALLEL_MIN_CHUNK
+    Smallest number of match positions given to one task by parameterised_match_parallel.
+*/
+#ifndef PM_PARALLEL_MIN_CHUNK
+#define PM_PARALLEL_MIN_CHUNK (1 << 16)
+#endif
+
+/*
+    typedef struct pm_chunk
+    The matches ending in one range of the text, found by one task of parameterised_match_parallel.
+    Components:
+        int start    - First text index a match may end at
+        int end      - One past the last text index a match may end at
+        int *results - The matches found, in order
+        int matches  - Number of matches found
+        int capacity - Size of results
+*/
+typedef struct {
+    int start, end, *results, matches, capacity;
+} pm_chunk;
+
+/*
+    typedef struct pm_parallel
+    Work shared between the threads of parameterised_match_parallel.
+    Components:
+        void            **T         - The text
+        element_func    get_element - Function retrieving the i-th symbol of the text
+        pm_pattern      pattern     - The compiled pattern
+        pm_chunk        *chunks     - The tasks, in text order
+        int             n_chunks    - Number of tasks
+        int             next        - First task not yet taken
+        pthread_mutex_t lock        - Guards next
+*/
+typedef struct {
+    void **T;
+    element_func get_element;
+    pm_pattern pattern;
+    pm_chunk *chunks;
+    int n_chunks, next;
+    pthread_mutex_t lock;
+} pm_parallel;
+
+/*
+    pm_parallel_worker
+    Thread body for parameterised_match_parallel: takes tasks until none are left, reusing one state block.
+    Parameters:
+        void *arg - The shared pm_parallel
+    Returns void*:
+        NULL
+    Notes:
+        A task for matches ending in [start, end) streams T from start - m + 1 with a fresh state. Every symbol in a window
+        ending in the range is then preceded by the m - 1 symbols that can share the window, so its predecessor distance
+        is exact wherever it affects a match, and positions before start cannot end a full window.
+*/
+void *pm_parallel_worker(void *arg) {
+    pm_parallel *work = arg;
+    pm_chunk *chunk;
+    pm_state *state;
+    void *block = malloc(pm_state_bytes(work->pattern));
+    int i, offset, task;
+    while (1) {
+        pthread_mutex_lock(&work->lock);
+        task = work->next++;
+        pthread_mutex_unlock(&work->lock);
+        if (task >= work->n_chunks) break;
+
+        chunk = &work->chunks[task];
+        offset = chunk->start - work->pattern->m + 1;
+        if (offset < 0) offset = 0;
+        state = pm_state_init(work->pattern, block);
+        for (i = offset; i < chunk->end; i++) {
+            if (pm_stream_push(state, work->get_element(work->T, i)) == -1) continue;
+            if (chunk->matches == chunk->capacity) {
+                chunk->capacity = (chunk->capacity) ? chunk->capacity << 1 : 16;
+                chunk->results = realloc(chunk->results, chunk->capacity * sizeof(int));
             }
+            chunk->results[chunk->matches++] = i;
         }
-        if (mmatch_stream(&mmatch, lookup, i) == i) add_occurance(printer, T_prev, i, &P_i[0], tmp);
+        pm_free(state);
     }
+    free(block);
+    return NULL;
+}
 
-    mmatch_free(&mmatch);
-    rbtree_destroy(t_pred);
-    for (i = 0; i < lm; i++) {
-        fingerprint_free(P_i[i].P);
-        fingerprint_free(P_i[i].period_f);
-        fingerprint_free(P_i[i].VOs[0].T_f);
-        fingerprint_free(P_i[i].VOs[1].T_f);
-        for (k = 0; k < s_sigma; k++) mpz_clear(P_i[i].to_zero[k].r_z);
-        free(P_i[i].to_zero);
-    }
-    free(P_i);
-    mpz_clear(r_z);
+/*
+    parameterised_match_parallel
+    Finds every p-match of a pattern in a text held in memory, splitting the text between threads.
+    Parameters:
+        void         **T         - The text
+        int          n           - Length of the text
+        void         **P         - The pattern
+        int          m           - Length of the pattern
+        int          alpha       - Desired accuracy of the fingerprints
+        compare_func compare     - Comparison function for symbols
+        element_func get_element - Function retrieving the i-th symbol of a string, called from every thread
+        int          pred_mode   - Predecessor backend, see predecessor.h
+        int          threads     - Number of threads to use, including the calling thread; less than 1 means 1
+        int          *results    - Array for the index of the last symbol of every match
+    Returns int:
+        Number of matches, stored in results in increasing order as by parameterised_match
+    Notes:
+        The pattern is compiled once and shared. The match positions are split into about four tasks per thread, of at
+        least PM_PARALLEL_MIN_CHUNK and m positions, so each thread re-reads at most m - 1 symbols per task.
+        If a thread cannot be created, the threads already running and the calling thread take its tasks.
+*/
+int parameterised_match_parallel(void **T, int n, void **P, int m, int alpha, compare_func compare, element_func get_element, int pred_mode, int threads, int *results) {
+    int i, size, started, matches = 0;
+    pthread_t *pool;
+    pm_parallel work;
+    if (m > n) return 0;
+
+    if (threads < 1) threads = 1;
+    size = ((long)n - m + ((long)threads << 2)) / ((long)threads << 2);
+    if (size < PM_PARALLEL_MIN_CHUNK) size = PM_PARALLEL_MIN_CHUNK;
+    if (size < m) size = m;
+    work.T = T;
+    work.get_element = get_element;
+    work.pattern = pm_compile(P, m, compare, get_element, pred_mode, fingerprinter_cached(n, alpha));
+    work.n_chunks = (n - m + size) / size;
+    work.chunks = calloc(work.n_chunks, sizeof(pm_chunk));
+    work.next = 0;
+    pthread_mutex_init(&work.lock, NULL);
+    for (i = 0; i < work.n_chunks; i++) {
+        work.chunks[i].start = m - 1 + i * size;
+        work.chunks[i].end = (i == work.n_chunks - 1) ? n : m - 1 + (i + 1) * size;
+    }
+
+    if (threads > work.n_chunks) threads = work.n_chunks;
+    pool = malloc(threads * sizeof(pthread_t));
+    for (started = 1; started < threads; started++) if (pthread_create(&pool[started], NULL, pm_parallel_worker, &work)) break;
+    pm_parallel_worker(&work);
+    for (i = 1; i < started; i++) pthread_join(pool[i], NULL);
+
+    for (i = 0; i < work.n_chunks; i++) {
+        if (work.chunks[i].matches) memcpy(&results[matches], work.chunks[i].results, work.chunks[i].matches * sizeof(int));
+        matches += work.chunks[i].matches;
+        free(work.chunks[i].results);
+    }
+
+    pthread_mutex_destroy(&work.lock);
+    pm_pattern_free(work.pattern);
+    free(work.chunks);
+    free(pool);
     return matches;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,67 @@
+#include "predecessor.h"
+#include <assert.h>
+
+/*
+    free_entries
+    Counts the unused entries of a PRED_WINDOW structure.
+    Parameters:
+        predecessor *pred - The predecessor structure
+    Returns int:
+        Length of the list of unused entries
+*/
+int free_entries(predecessor *pred) {
+    int entry, count = 0;
+    for (entry = pred->unused; entry != -1; entry = pred->entries[entry].next) count++;
+    return count;
+}
+
+int main(void) {
+    int i, j, k, window, expected, last[64];
+    int windows[3] = {1, 5, 40};
+    predecessor pred = predecessor_build(PRED_WINDOW, NULL, 3);
+    assert(predecessor_exchange(&pred, (void*)7, 0) == 0);
+    assert(predecessor_exchange(&pred, (void*)7, 3) == 3);
+    assert(predecessor_exchange(&pred, (void*)7, 7) == 0);
+    assert(predecessor_exchange(&pred, (void*)8, 8) == 0);
+    assert(predecessor_exchange(&pred, (void*)7, 9) == 2);
+    assert(predecessor_exchange(&pred, (void*)8, 12) == 0);
+    predecessor_free(&pred);
+
+    pred = predecessor_build(PRED_WINDOW, NULL, 2);
+    for (i = 0; i < 3; i++) assert(predecessor_exchange(&pred, (void*)(long)(100 + i), i) == 0);
+    assert(pred.unused == -1);
+    assert(pred.table.num == 3);
+    assert(predecessor_exchange(&pred, (void*)200, 10) == 0);
+    assert(pred.table.num == 1);
+    assert((pred.oldest == pred.newest) && (pred.newest >= 0) && (pred.newest <= 2));
+    assert(free_entries(&pred) == 2);
+    assert(predecessor_exchange(&pred, (void*)100, 11) == 0);
+    assert(predecessor_exchange(&pred, (void*)200, 12) == 2);
+    assert(predecessor_exchange(&pred, (void*)101, 13) == 0);
+    assert((pred.table.num == 3) && (pred.unused == -1));
+    predecessor_free(&pred);
+
+    srand(1);
+    for (k = 0; k < 3; k++) {
+        window = windows[k];
+        pred = predecessor_build(PRED_WINDOW, NULL, window);
+        for (j = 0; j < 64; j++) last[j] = -1;
+        for (i = 0; i < 200000; i++) {
+            j = (rand() & 1) ? rand() % 64 : rand() % 8;
+            expected = ((last[j] != -1) && (i - last[j] <= window)) ? i - last[j] : 0;
+            assert(predecessor_exchange(&pred, (void*)(long)(j * 1024 + 1), i) == expected);
+            last[j] = i;
+            if (!(i % 997)) assert((pred.table.num <= window + 1) && (pred.table.num + free_entries(&pred) == window + 1));
+        }
+        predecessor_free(&pred);
+    }
+
+    char block[4096] __attribute__((aligned(8)));
+    assert(predecessor_bytes(PRED_WINDOW, 40) <= sizeof(block));
+    pred = predecessor_build_at(PRED_WINDOW, NULL, 40, block);
+    for (i = 0; i < 1000; i++) assert(predecessor_exchange(&pred, (void*)(long)(i % 50), i) == 0);
+    for (i = 1000; i < 2000; i++) assert(predecessor_exchange(&pred, (void*)(long)(i % 30 + 100), i) == ((i < 1030) ? 0 : 30));
+    predecessor_free(&pred);
+
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*
+    predecessor.h
+    Tracks how long ago each symbol of a stream last occured.
+    PRED_RBTREE works for any symbol type with a comparison function. PRED_BYTE and PRED_SHORT are for 8-bit and 16-bit
+    alphabets, where the symbol indexes a flat table directly and an update is one load and one store. PRED_HASH is for
+    large integer alphabets, where the symbol (up to 64 bits, passed as the void*) keys an open-addressing hash table.
+    PRED_WINDOW is PRED_HASH for unbounded streams: symbols not seen in the last window positions are forgotten, so memory
+    is O(min(sigma, window)) however long the stream runs.
+*/
+
+#ifndef PREDECESSOR
+#define PREDECESSOR
+
+#include "rbtree.c"
+#include "open_hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PRED_RBTREE 0
+#define PRED_BYTE 1
+#define PRED_SHORT 2
+#define PRED_HASH 3
+#define PRED_WINDOW 4
+
+/*
+    PRED_POOL
+    Initial number of nodes pooled by a PRED_RBTREE structure.
+*/
+#define PRED_POOL 64
+
+/*
+    typedef struct pred_entry
+    Symbol tracked by a PRED_WINDOW structure. Entries form a list in order of last occurance, linked by index.
+    Components:
+        uint64_t key  - The symbol
+        int      pos  - Index of the last occurance
+        int      prev - Entry of the previous symbol to occur, or -1
+        int      next - Entry of the next symbol to occur, or -1. Links the free entries.
+*/
+typedef struct {
+    uint64_t key;
+    int pos, prev, next;
+} pred_entry;
+
+/*
+    typedef struct predecessor
+    Structure holding the last occurance of every symbol.
+    Components:
+        int          mode     - One of PRED_RBTREE, PRED_BYTE, PRED_SHORT, PRED_HASH or PRED_WINDOW
+        rbtree       tree     - Last occurances for PRED_RBTREE
+        int          *last    - Last occurance plus one, indexed by symbol, for PRED_BYTE and PRED_SHORT
+        open_hash    table    - Last occurances for PRED_HASH, or the entry of each symbol for PRED_WINDOW
+        compare_func compare  - Comparison function for PRED_RBTREE
+        pred_entry   *entries - Pool of window + 1 entries for PRED_WINDOW
+        int          window   - Largest distance reported by PRED_WINDOW
+        int          oldest   - Entry of the least recent symbol, or -1
+        int          newest   - Entry of the most recent symbol, or -1
+        int          unused   - First free entry, or -1
+        int          external - Whether the tables live in caller-owned memory, see predecessor_build_at
+*/
+typedef struct {
+    int mode;
+    rbtree tree;
+    int *last;
+    open_hash table;
+    compare_func compare;
+    pred_entry *entries;
+    int window, oldest, newest, unused, external;
+} predecessor;
+
+/*
+    predecessor_bytes
+    Size of the tables of a predecessor structure whose memory does not grow.
+    Parameters:
+        int mode   - One of PRED_RBTREE, PRED_BYTE, PRED_SHORT, PRED_HASH or PRED_WINDOW
+        int window - Largest distance to report, only used by PRED_WINDOW
+    Returns size_t:
+        The bytes predecessor_build_at needs for PRED_BYTE, PRED_SHORT and PRED_WINDOW
+        0 for PRED_RBTREE and PRED_HASH, which allocate as symbols arrive
+*/
+size_t predecessor_bytes(int mode, int window) {
+    if (mode == PRED_BYTE) return (1 << 8) * sizeof(int);
+    if (mode == PRED_SHORT) return (1 << 16) * sizeof(int);
+    if (mode == PRED_WINDOW) return openhash_bytes(window + 1) + (window + 1) * sizeof(pred_entry);
+    return 0;
+}
+
+/*
+    predecessor_build_at
+    Constructs an empty predecessor structure, placing fixed-size tables in caller-owned memory.
+    Parameters:
+        int          mode    - One of PRED_RBTREE, PRED_BYTE, PRED_SHORT, PRED_HASH or PRED_WINDOW
+        compare_func compare - Comparison function for symbols, only used by PRED_RBTREE
+        int          window  - Largest distance to report, only used by PRED_WINDOW
+        void         *block  - predecessor_bytes(mode, window) bytes aligned for a uint64_t, or NULL to allocate
+    Returns predecessor:
+        The constructed structure
+*/
+predecessor predecessor_build_at(int mode, compare_func compare, int window, void *block) {
+    int i;
+    predecessor pred;
+    pred.mode = mode;
+    pred.compare = compare;
+    pred.tree = NULL;
+    pred.last = NULL;
+    pred.table.entries = NULL;
+    pred.entries = NULL;
+    pred.external = (block != NULL) && predecessor_bytes(mode, window);
+    if (!pred.external) block = NULL;
+    if (mode == PRED_BYTE) pred.last = (block) ? memset(block, 0, predecessor_bytes(mode, 0)) : calloc(1 << 8, sizeof(int));
+    else if (mode == PRED_SHORT) pred.last = (block) ? memset(block, 0, predecessor_bytes(mode, 0)) : calloc(1 << 16, sizeof(int));
+    else if (mode == PRED_HASH) pred.table = openhash_build(0);
+    else if (mode == PRED_WINDOW) {
+        pred.window = window;
+        pred.table = openhash_build_at(window + 1, block);
+        pred.entries = (block) ? (pred_entry*)((char*)block + openhash_bytes(window + 1)) : malloc((window + 1) * sizeof(pred_entry));
+        for (i = 0; i < window; i++) pred.entries[i].next = i + 1;
+        pred.entries[window].next = -1;
+        pred.unused = 0;
+        pred.oldest = -1;
+        pred.newest = -1;
+    } else pred.tree = rbtree_create_pool(PRED_POOL);
+    return pred;
+}
+
+/*
+    predecessor_build
+    Constructs an empty predecessor structure.
+    Parameters:
+        int          mode    - One of PRED_RBTREE, PRED_BYTE, PRED_SHORT, PRED_HASH or PRED_WINDOW
+        compare_func compare - Comparison function for symbols, only used by PRED_RBTREE
+        int          window  - Largest distance to report, only used by PRED_WINDOW
+    Returns predecessor:
+        The constructed structure
+*/
+predecessor predecessor_build(int mode, compare_func compare, int window) {
+    return predecessor_build_at(mode, compare, window, NULL);
+}
+
+/*
+    predecessor_window
+    Records an occurance of a symbol in a PRED_WINDOW structure.
+    Parameters:
+        predecessor *pred - The predecessor structure
+        uint64_t    key   - The symbol
+        int         i     - The index of the symbol
+    Returns int:
+        i minus the index of the previous occurance of key
+        0 if key has not occured in the last window positions
+*/
+int predecessor_window(predecessor *pred, uint64_t key, int i) {
+    pred_entry *entries = pred->entries;
+    int entry, distance = 0;
+
+    while ((pred->oldest != -1) && (entries[pred->oldest].pos < i - pred->window)) {
+        entry = pred->oldest;
+        openhash_delete(&pred->table, entries[entry].key);
+        pred->oldest = entries[entry].next;
+        if (pred->oldest != -1) entries[pred->oldest].prev = -1;
+        else pred->newest = -1;
+        entries[entry].next = pred->unused;
+        pred->unused = entry;
+    }
+
+    entry = openhash_lookup(&pred->table, key, -1);
+    if (entry != -1) {
+        distance = i - entries[entry].pos;
+        if (entry == pred->newest) {
+            entries[entry].pos = i;
+            return distance;
+        }
+        if (entries[entry].prev != -1) entries[entries[entry].prev].next = entries[entry].next;
+        else pred->oldest = entries[entry].next;
+        entries[entries[entry].next].prev = entries[entry].prev;
+    } else {
+        entry = pred->unused;
+        pred->unused = entries[entry].next;
+        entries[entry].key = key;
+        openhash_insert(&pred->table, key, entry);
+    }
+
+    entries[entry].pos = i;
+    entries[entry].prev = pred->newest;
+    entries[entry].next = -1;
+    if (pred->newest != -1) entries[pred->newest].next = entry;
+    else pred->oldest = entry;
+    pred->newest = entry;
+    return distance;
+}
+
+/*
+    predecessor_exchange_index
+    predecessor_exchange for a PRED_BYTE or PRED_SHORT structure, taking the symbol as its index in the table.
+    Parameters:
+        predecessor  *pred - The predecessor structure
+        unsigned int index - The symbol, below 1 << 8 for PRED_BYTE and 1 << 16 for PRED_SHORT
+        int          i     - The index of the symbol
+    Returns int:
+        As predecessor_exchange
+*/
+static inline int predecessor_exchange_index(predecessor *pred, unsigned int index, int i) {
+    int last = pred->last[index];
+    pred->last[index] = i + 1;
+    return (last) ? i + 1 - last : 0;
+}
+
+/*
+    predecessor_exchange_key
+    predecessor_exchange for a PRED_HASH structure, taking the symbol as a 64-bit key.
+    Parameters:
+        predecessor *pred - The predecessor structure
+        uint64_t    key   - The symbol
+        int         i     - The index of the symbol
+    Returns int:
+        As predecessor_exchange
+*/
+static inline int predecessor_exchange_key(predecessor *pred, uint64_t key, int i) {
+    return i - openhash_exchange(&pred->table, key, i, i);
+}
+
+/*
+    predecessor_exchange
+    Records an occurance of a symbol and returns the distance to its previous occurance.
+    Parameters:
+        predecessor *pred - The predecessor structure
+        void        *key  - The symbol
+        int         i     - The index of the symbol
+    Returns int:
+        i minus the index of the previous occurance of key
+        0 if this is the first time we've seen key
+*/
+int predecessor_exchange(predecessor *pred, void *key, int i) {
+    if (pred->mode == PRED_BYTE) return predecessor_exchange_index(pred, (unsigned char)(long)key, i);
+    else if (pred->mode == PRED_SHORT) return predecessor_exchange_index(pred, (unsigned short)(long)key, i);
+    else if (pred->mode == PRED_HASH) return predecessor_exchange_key(pred, (uint64_t)(uintptr_t)key, i);
+    else if (pred->mode == PRED_WINDOW) return predecessor_window(pred, (uint64_t)(uintptr_t)key, i);
+    return i - (int)(long)rbtree_exchange(pred->tree, key, (void*)(long)i, (void*)(long)i, pred->compare);
+}
+
+/*
+    predecessor_free
+    Frees a predecessor structure from memory. Tables in caller-owned memory are left to the caller.
+    Parameters:
+        predecessor *pred - The structure to free
+*/
+void predecessor_free(predecessor *pred) {
+    if (pred->tree) rbtree_destroy(pred->tree);
+    if (pred->external) return;
+    free(pred->last);
+    free(pred->table.entries);
+    free(pred->entries);
+}
+
+#endif
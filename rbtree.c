@@ -20,6 +20,13 @@ Retrieved from: http://en.literateprograms.org/Red-black_tree_(C)?oldid=19567
 #include <assert.h>
 #include <stdlib.h>
 
+/* Consistency checks cost a comparison or a pointer walk on every call, so they only run when verifying */
+#ifdef VERIFY_RBTREE
+#define rb_assert(x) assert(x)
+#else
+#define rb_assert(x) ((void)0)
+#endif
+
 typedef rbtree_node node;
 typedef enum rbtree_node_color color;
 
@@ -34,7 +41,8 @@ static void verify_property_4(node root);
 static void verify_property_5(node root);
 static void verify_property_5_helper(node n, int black_count, int* black_count_path);
 
-static node new_node(void* key, void* value, color node_color, node left, node right);
+static node new_node(rbtree t, void* key, void* value, color node_color, node left, node right);
+static void free_node(rbtree t, node n);
 static node lookup_node(rbtree t, void* key, compare_func compare);
 static void rotate_left(rbtree t, node n);
 static void rotate_right(rbtree t, node n);
@@ -54,23 +62,23 @@ static void delete_case5(rbtree t, node n);
 static void delete_case6(rbtree t, node n);
 
 node grandparent(node n) {
-    assert (n != NULL);
-    assert (n->parent != NULL); /* Not the root node */
-    assert (n->parent->parent != NULL); /* Not child of root */
+    rb_assert(n != NULL);
+    rb_assert(n->parent != NULL); /* Not the root node */
+    rb_assert(n->parent->parent != NULL); /* Not child of root */
     return n->parent->parent;
 }
 node sibling(node n) {
-    assert (n != NULL);
-    assert (n->parent != NULL); /* Root node has no sibling */
+    rb_assert(n != NULL);
+    rb_assert(n->parent != NULL); /* Root node has no sibling */
     if (n == n->parent->left)
         return n->parent->right;
     else
         return n->parent->left;
 }
 node uncle(node n) {
-    assert (n != NULL);
-    assert (n->parent != NULL); /* Root node has no uncle */
-    assert (n->parent->parent != NULL); /* Children of root have no uncle */
+    rb_assert(n != NULL);
+    rb_assert(n->parent != NULL); /* Root node has no uncle */
+    rb_assert(n->parent->parent != NULL); /* Children of root have no uncle */
     return sibling(n->parent);
 }
 void verify_properties(rbtree t) {
@@ -83,22 +91,22 @@ void verify_properties(rbtree t) {
 #endif
 }
 void verify_property_1(node n) {
-    assert(node_color(n) == RED || node_color(n) == BLACK);
+    rb_assert(node_color(n) == RED || node_color(n) == BLACK);
     if (n == NULL) return;
     verify_property_1(n->left);
     verify_property_1(n->right);
 }
 void verify_property_2(node root) {
-    assert(node_color(root) == BLACK);
+    rb_assert(node_color(root) == BLACK);
 }
 color node_color(node n) {
     return n == NULL ? BLACK : n->color;
 }
 void verify_property_4(node n) {
     if (node_color(n) == RED) {
-        assert (node_color(n->left)   == BLACK);
-        assert (node_color(n->right)  == BLACK);
-        assert (node_color(n->parent) == BLACK);
+        rb_assert(node_color(n->left)   == BLACK);
+        rb_assert(node_color(n->right)  == BLACK);
+        rb_assert(node_color(n->parent) == BLACK);
     }
     if (n == NULL) return;
     verify_property_4(n->left);
@@ -117,7 +125,7 @@ void verify_property_5_helper(node n, int black_count, int* path_black_count) {
         if (*path_black_count == -1) {
             *path_black_count = black_count;
         } else {
-            assert (black_count == *path_black_count);
+            rb_assert(black_count == *path_black_count);
         }
         return;
     }
@@ -127,11 +135,38 @@ void verify_property_5_helper(node n, int black_count, int* path_black_count) {
 rbtree rbtree_create() {
     rbtree t = malloc(sizeof(struct rbtree_t));
     t->root = NULL;
+    t->free_nodes = NULL;
+    t->blocks = NULL;
+    t->block_used = 0;
+    t->block_size = 0;
     verify_properties(t);
     return t;
 }
-node new_node(void* key, void* value, color node_color, node left, node right) {
-    node result = malloc(sizeof(struct rbtree_node_t));
+rbtree rbtree_create_pool(int capacity) {
+    rbtree t = rbtree_create();
+    if (capacity < 1) capacity = 1;
+    t->blocks = malloc(sizeof(struct rbtree_block_t) + capacity * sizeof(struct rbtree_node_t));
+    t->blocks->next = NULL;
+    t->block_size = capacity;
+    return t;
+}
+node new_node(rbtree t, void* key, void* value, color node_color, node left, node right) {
+    node result;
+    if (t->blocks == NULL) {
+        result = malloc(sizeof(struct rbtree_node_t));
+    } else if (t->free_nodes != NULL) {
+        result = t->free_nodes;
+        t->free_nodes = result->right;
+    } else {
+        if (t->block_used == t->block_size) {
+            rbtree_block block = malloc(sizeof(struct rbtree_block_t) + (t->block_size << 1) * sizeof(struct rbtree_node_t));
+            block->next = t->blocks;
+            t->blocks = block;
+            t->block_size <<= 1;
+            t->block_used = 0;
+        }
+        result = &t->blocks->nodes[t->block_used++];
+    }
     result->key = key;
     result->value = value;
     result->color = node_color;
@@ -142,6 +177,14 @@ node new_node(void* key, void* value, color node_color, node left, node right) {
     result->parent = NULL;
     return result;
 }
+void free_node(rbtree t, node n) {
+    if (t->blocks == NULL) {
+        free(n);
+    } else {
+        n->right = t->free_nodes;
+        t->free_nodes = n;
+    }
+}
 node lookup_node(rbtree t, void* key, compare_func compare) {
     node n = t->root;
     while (n != NULL) {
@@ -151,7 +194,7 @@ node lookup_node(rbtree t, void* key, compare_func compare) {
         } else if (comp_result < 0) {
             n = n->left;
         } else {
-            assert(comp_result > 0);
+            rb_assert(comp_result > 0);
             n = n->right;
         }
     }
@@ -196,26 +239,33 @@ void replace_node(rbtree t, node oldn, node newn) {
     }
 }
 void rbtree_insert(rbtree t, void* key, void* value, compare_func compare) {
-    node inserted_node = new_node(key, value, RED, NULL, NULL);
+    rbtree_exchange(t, key, value, NULL, compare);
+}
+void* rbtree_exchange(rbtree t, void* key, void* value, void* def, compare_func compare) {
+    node inserted_node;
     if (t->root == NULL) {
+        inserted_node = new_node(t, key, value, RED, NULL, NULL);
         t->root = inserted_node;
     } else {
         node n = t->root;
         while (1) {
             int comp_result = compare(key, n->key);
             if (comp_result == 0) {
+                void* old = n->value;
                 n->value = value;
-                return;
+                return old;
             } else if (comp_result < 0) {
                 if (n->left == NULL) {
+                    inserted_node = new_node(t, key, value, RED, NULL, NULL);
                     n->left = inserted_node;
                     break;
                 } else {
                     n = n->left;
                 }
             } else {
-                assert (comp_result > 0);
+                rb_assert(comp_result > 0);
                 if (n->right == NULL) {
+                    inserted_node = new_node(t, key, value, RED, NULL, NULL);
                     n->right = inserted_node;
                     break;
                 } else {
@@ -227,6 +277,7 @@ void rbtree_insert(rbtree t, void* key, void* value, compare_func compare) {
     }
     insert_case1(t, inserted_node);
     verify_properties(t);
+    return def;
 }
 void insert_case1(rbtree t, node n) {
     if (n->parent == NULL)
@@ -266,7 +317,7 @@ void insert_case5(rbtree t, node n) {
     if (n == n->parent->left && n->parent == grandparent(n)->left) {
         rotate_right(t, grandparent(n));
     } else {
-        assert (n == n->parent->right && n->parent == grandparent(n)->right);
+        rb_assert(n == n->parent->right && n->parent == grandparent(n)->right);
         rotate_left(t, grandparent(n));
     }
 }
@@ -282,7 +333,7 @@ void rbtree_delete(rbtree t, void* key, compare_func compare) {
         n = pred;
     }
 
-    assert(n->left == NULL || n->right == NULL);
+    rb_assert(n->left == NULL || n->right == NULL);
     child = n->right == NULL ? n->left  : n->right;
     if (node_color(n) == BLACK) {
         n->color = node_color(child);
@@ -291,12 +342,12 @@ void rbtree_delete(rbtree t, void* key, compare_func compare) {
     replace_node(t, n, child);
     if (n->parent == NULL && child != NULL) // root should be black
         child->color = BLACK;
-    free(n);
+    free_node(t, n);
 
     verify_properties(t);
 }
 static node maximum_node(node n) {
-    assert (n != NULL);
+    rb_assert(n != NULL);
     while (n->right != NULL) {
         n = n->right;
     }
@@ -368,13 +419,13 @@ void delete_case6(rbtree t, node n) {
     sibling(n)->color = node_color(n->parent);
     n->parent->color = BLACK;
     if (n == n->parent->left) {
-        assert (node_color(sibling(n)->right) == RED);
+        rb_assert(node_color(sibling(n)->right) == RED);
         sibling(n)->right->color = BLACK;
         rotate_left(t, n->parent);
     }
     else
     {
-        assert (node_color(sibling(n)->left) == RED);
+        rb_assert(node_color(sibling(n)->left) == RED);
         sibling(n)->left->color = BLACK;
         rotate_right(t, n->parent);
     }
@@ -387,7 +438,13 @@ void destroy_nodes(rbtree_node n) {
 }
 
 void rbtree_destroy(rbtree t) {
-    if (t->root != NULL) destroy_nodes(t->root);
+    if (t->blocks != NULL) {
+        while (t->blocks != NULL) {
+            rbtree_block next = t->blocks->next;
+            free(t->blocks);
+            t->blocks = next;
+        }
+    } else if (t->root != NULL) destroy_nodes(t->root);
     free(t);
 }
 
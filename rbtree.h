@@ -26,15 +26,27 @@ typedef struct rbtree_node_t {
     enum rbtree_node_color color;
 } *rbtree_node;
 
+/* Nodes of a pooled tree are carved from blocks, each twice the size of the previous one */
+typedef struct rbtree_block_t {
+    struct rbtree_block_t* next;
+    struct rbtree_node_t nodes[];
+} *rbtree_block;
+
 typedef struct rbtree_t {
     rbtree_node root;
+    rbtree_node free_nodes;
+    rbtree_block blocks;
+    int block_used;
+    int block_size;
 } *rbtree;
 
 typedef int (*compare_func)(void* left, void* right);
 
 rbtree rbtree_create();
+rbtree rbtree_create_pool(int capacity);
 void* rbtree_lookup(rbtree t, void* key, void* def, compare_func compare);
 void rbtree_insert(rbtree t, void* key, void* value, compare_func compare);
+void* rbtree_exchange(rbtree t, void* key, void* value, void* def, compare_func compare);
 void rbtree_delete(rbtree t, void* key, compare_func compare);
 void rbtree_destroy(rbtree t);
 